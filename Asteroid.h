@@ -2,11 +2,19 @@
 #ifndef ASTEROID_MANAGER_H
 #define ASTEROID_MANAGER_H
 
+#include <cstddef>
+#include <memory>
 #include <vector>
 #include <glm/glm.hpp>
 #include "objmesh.h"
 #include "helper/glslprogram.h"
 #include "aabb.h"
+#include "frustum.h"
+#include "AsteroidCuller.h"
+#include "AsteroidImpostors.h"
+#include "frustumculler.h"
+#include "occlusionculler.h"
+#include "helper/streambuffer.h"
 
 struct Asteroid {
     glm::vec3 position;
@@ -15,6 +23,25 @@ struct Asteroid {
     float rotationSpeed;
 };
 
+// One asteroid in the instance buffer read by astroid.vert.  The layout
+// matches the std430 AsteroidInstance struct there; each vec3 shares its
+// 16-byte slot with the float after it.
+constexpr unsigned int ASTEROID_INSTANCE_BINDING = 1;
+
+struct AsteroidInstance {
+    glm::vec3 position;
+    float rotationSpeed;       // Radians per second about Y
+    glm::vec3 rotation;        // Euler angles at upload time
+    float padding0;
+    glm::vec3 scale;
+    float padding1;
+};
+
+static_assert(offsetof(AsteroidInstance, rotationSpeed) == 12, "AsteroidInstance must match std430");
+static_assert(offsetof(AsteroidInstance, rotation) == 16, "AsteroidInstance must match std430");
+static_assert(offsetof(AsteroidInstance, scale) == 32, "AsteroidInstance must match std430");
+static_assert(sizeof(AsteroidInstance) == 48, "AsteroidInstance must match std430");
+
 class AsteroidManager {
 private:
     std::vector<Asteroid> asteroids;
@@ -22,23 +49,126 @@ private:
     GLuint albedoMap;
     GLuint normalMap;
     GLSLProgram* shaderProgram;
+    GLSLProgram* fadeProgram;   // The same with IMPOSTOR_FADE, for the level that fades out
+    GLSLProgram* depthProgram;  // Position-only build of the same vertex shader
+
+    // Copy of the asteroid list handed to the render side by publish();
+    // replaced, never modified, when asteroids are added or removed
+    std::shared_ptr<const std::vector<Asteroid>> published;
+    float elapsedTime;          // Sum of update() steps
+
+    // Instance buffer holding every asteroid, drawn with one instanced call.
+    // It is only rewritten when the published list changes; the shader
+    // advances each asteroid's spin itself from spinTimeUniform.
+    std::shared_ptr<const std::vector<Asteroid>> drawn; // List the buffer was written from
+    GLuint instanceBuffer;
+    size_t instanceCapacity;
+    float uploadTime;           // elapsedTime when the instances were written
+    float spinTime;             // Spin time of this frame's draws
+    float prevSpinTime;         // Spin time drawn last frame, negative after an upload
+    UniformHandle<float> spinTimeUniform;
+    UniformHandle<float> prevSpinTimeUniform;
+    UniformHandle<float> fadeSpinTimeUniform;
+    UniformHandle<float> fadePrevSpinTimeUniform;
+    UniformHandle<float> depthSpinTimeUniform;
+
+    // Frustum/distance culling and LOD selection on the GPU
+    AsteroidCuller culler;
+    float boundingRadius;       // Mesh bounding sphere at unit scale
+
+    // Distant asteroids are drawn as impostor quads instead of meshes
+    AsteroidImpostors impostors;
+
+    // Optional CPU culling in its place: SIMD frustum culling, then
+    // software occlusion culling whose result is applied a frame later
+    bool cpuCulling;            // Game-side setting, passed on in Frame
+    FrustumCuller cpuCuller;
+    OcclusionCuller occlusionCuller;
+    std::vector<uint32_t> visibleAsteroids;
+    std::vector<GLuint> lodLists[AsteroidCuller::MAX_LODS];
+    std::vector<OcclusionCuller::OrientedBox> sceneOccluders;
+    std::vector<uint32_t> hiddenAsteroids;
+    std::vector<uint8_t> hiddenFlags;
+    uint32_t instanceGeneration;  // Bumped whenever the instance list changes
+    uint32_t occlusionGeneration; // instanceGeneration of the running occlusion job
+    size_t occludedDraws;         // Asteroids skipped by occlusion last frame
+    void cullOnCpu(const glm::mat4& viewProjection, const glm::vec3& cameraPos, StreamBuffer& stream);
+    void startOcclusion(const glm::mat4& viewProjection, const glm::vec3& cameraPos);
+
+    void uploadInstances();
+
+    // Levels of detail and the camera distance each is drawn to
+    static const int LOD_LEVELS = 3;
+    static const float LOD_DISTANCES[LOD_LEVELS];
+
+    // Impostors take over from the last mesh level out to this distance,
+    // cross-fading over the end of the mesh level's range
+    static const float IMPOSTOR_DISTANCE;
+    static const float IMPOSTOR_FADE_RANGE;
 
     // Generation parameters
     float spawnRadius;
     int asteroidCount;
 
 public:
-    AsteroidManager(GLSLProgram* program);
+    // Programs compiled by the scene; the manager sets their uniforms
+    struct Programs {
+        GLSLProgram* shading;       // astroid.vert/frag
+        GLSLProgram* fadeShading;   // astroid.vert/frag with IMPOSTOR_FADE
+        GLSLProgram* depth;         // astroid.vert with DEPTH_ONLY
+        GLSLProgram* cull;          // asteroid_cull.comp
+        GLSLProgram* impostor;      // impostor.vert/frag
+        GLSLProgram* impostorBake;  // impostor_bake.vert/frag
+    };
+
+    AsteroidManager(const Programs& programs);
     ~AsteroidManager();
 
     bool initialize(const std::string& meshPath,
         const std::string& albedoPath,
         const std::string& normalPath);
 
+    // What the render side draws from for one simulated frame.  The list
+    // is shared between frames and only copied when it changes, so the
+    // render thread can read it while the game thread moves on.
+    struct Frame {
+        std::shared_ptr<const std::vector<Asteroid>> asteroids;
+        float elapsedTime;
+        bool cpuCulling;
+    };
+
+    // ---- Game thread ----
     void generateAsteroids(const glm::vec3& playerPosition, float radius, int count);
     void update(float deltaTime, const glm::vec3& playerPosition);
-    void render(const glm::mat4& view, const glm::mat4& projection,
-        const glm::vec3& lightPos, const glm::vec3& viewPos);
+    Frame publish();
+
+    // ---- Render thread ----
+    // Picks this frame's visible asteroids and levels of detail; per-frame
+    // draw data goes into `stream`.  Call once a frame before drawing.
+    void cull(const Frame& frame, const glm::mat4& viewProjection, const glm::vec3& cameraPos, StreamBuffer& stream);
+
+    // Writes the depth of the nearest level of detail only
+    void renderDepth();
+
+    // Draws the asteroids picked by cull(), distant ones as impostors; light
+    // is read from the FrameData uniform block and the light clusters.  With
+    // depthPrepassed, the level renderDepth() drew is shaded with a GL_EQUAL
+    // depth test.
+    void render(bool depthPrepassed);
+
+    // Occluders from other scene objects for the next CPU cull; each box
+    // must fit inside its object
+    void setOccluders(std::vector<OcclusionCuller::OrientedBox> boxes) { sceneOccluders = std::move(boxes); }
+
+    // Switches between GPU culling (the default) and SIMD CPU culling,
+    // from the next published frame
+    void setCpuCulling(bool enabled) { cpuCulling = enabled; }
+    bool isCpuCulling() const { return cpuCulling; }
+
+    // Counts and cost of the last CPU cull; render thread only
+    const FrustumCuller::Stats& getCullStats() const { return cpuCuller.stats(); }
+    const OcclusionCuller::Stats& getOcclusionStats() const { return occlusionCuller.stats(); }
+    size_t getOccludedDraws() const { return occludedDraws; }
 
     // Gets the complete bounding box for all asteroids
     Aabb getBoundingBox() const;
@@ -0,0 +1,204 @@
+#include "AsteroidCuller.h"
+#include "helper/glstatecache.h"
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+AsteroidCuller::AsteroidCuller(GLSLProgram* program) :
+    cullProgram(program),
+    vao(0),
+    commandBuffer(0),
+    visibleBuffer(0),
+    capacity(0),
+    indirectBuffer(0),
+    indirectOffset(0),
+    drawLevels(0),
+    radius(0.0f),
+    impostorVao(0),
+    fadeRange(0.0f)
+{
+}
+
+AsteroidCuller::~AsteroidCuller() {
+    if (commandBuffer) glDeleteBuffers(1, &commandBuffer);
+    if (visibleBuffer) glDeleteBuffers(1, &visibleBuffer);
+}
+
+void AsteroidCuller::initialize(const TriangleMesh& mesh, const std::vector<float>& lodDistances,
+    float boundingRadius) {
+    vao = mesh.getVao();
+    radius = boundingRadius;
+
+    // One level per distance, as far as the mesh has levels
+    const std::vector<TriangleMesh::Lod>& meshLods = mesh.getLods();
+    size_t count = std::min({ meshLods.size(), lodDistances.size(), (size_t)MAX_LODS });
+    lods.assign(meshLods.begin(), meshLods.begin() + count);
+    distances.assign(lodDistances.begin(), lodDistances.begin() + count);
+
+    for (int i = 0; i < Frustum::PLANE_COUNT; ++i) {
+        planeUniforms[i] = cullProgram->uniform<glm::vec4>(("frustumPlanes[" + std::to_string(i) + "]").c_str());
+    }
+    instanceCountUniform = cullProgram->uniform<GLuint>("instanceCount");
+    cullProgram->uniform<float>("boundingRadius").set(radius);
+    cullProgram->uniform<GLuint>("lodCount").set((GLuint)lods.size());
+    for (size_t i = 0; i < distances.size(); ++i) {
+        cullProgram->uniform<float>(("lodDistances[" + std::to_string(i) + "]").c_str()).set(distances[i]);
+    }
+    cullProgram->uniform<GLuint>("impostorLod").set((GLuint)MAX_LODS);
+
+    glCreateBuffers(1, &commandBuffer);
+    glNamedBufferStorage(commandBuffer, MAX_LODS * sizeof(DrawElementsIndirectCommand), nullptr, 0);
+
+    // Feed the visible lists to the vertex shader as a per-instance
+    // attribute; each command's baseInstance selects its level's list
+    glEnableVertexArrayAttrib(vao, INSTANCE_INDEX_ATTRIBUTE);
+    glVertexArrayAttribIFormat(vao, INSTANCE_INDEX_ATTRIBUTE, 1, GL_UNSIGNED_INT, 0);
+    glVertexArrayAttribBinding(vao, INSTANCE_INDEX_ATTRIBUTE, INSTANCE_INDEX_ATTRIBUTE);
+    glVertexArrayBindingDivisor(vao, INSTANCE_INDEX_ATTRIBUTE, 1);
+
+    std::cout << "[INFO] Asteroid culling with " << lods.size() << " levels of detail:";
+    for (size_t i = 0; i < lods.size(); ++i) {
+        std::cout << " " << lods[i].indexCount / 3 << " triangles to " << distances[i];
+    }
+    std::cout << std::endl;
+}
+
+void AsteroidCuller::setImpostors(GLuint quadVao, GLuint indexCount, float distance, float fade) {
+    if (lods.empty() || lods.size() >= (size_t)MAX_LODS) {
+        std::cerr << "[WARNING] No level of detail left for asteroid impostors" << std::endl;
+        return;
+    }
+    impostorVao = quadVao;
+    fadeRange = fade;
+
+    GLuint level = (GLuint)lods.size();
+    lods.push_back({ 0, indexCount });
+    distances.push_back(distance);
+    cullProgram->uniform<GLuint>("lodCount").set((GLuint)lods.size());
+    cullProgram->uniform<float>(("lodDistances[" + std::to_string(level) + "]").c_str()).set(distance);
+    cullProgram->uniform<GLuint>("impostorLod").set(level);
+    cullProgram->uniform<float>("fadeRange").set(fadeRange);
+
+    glEnableVertexArrayAttrib(impostorVao, INSTANCE_INDEX_ATTRIBUTE);
+    glVertexArrayAttribIFormat(impostorVao, INSTANCE_INDEX_ATTRIBUTE, 1, GL_UNSIGNED_INT, 0);
+    glVertexArrayAttribBinding(impostorVao, INSTANCE_INDEX_ATTRIBUTE, INSTANCE_INDEX_ATTRIBUTE);
+    glVertexArrayBindingDivisor(impostorVao, INSTANCE_INDEX_ATTRIBUTE, 1);
+
+    std::cout << "[INFO] Asteroid impostors from " << distances[level - 1] << " to " << distance
+              << ", cross-faded over " << fadeRange << std::endl;
+}
+
+void AsteroidCuller::reserve(size_t count) {
+    if (count <= capacity) return;
+
+    if (visibleBuffer) glDeleteBuffers(1, &visibleBuffer);
+    capacity = std::max(count, capacity * 2);
+    glCreateBuffers(1, &visibleBuffer);
+    glNamedBufferStorage(visibleBuffer, MAX_LODS * capacity * sizeof(GLuint), nullptr, 0);
+}
+
+void AsteroidCuller::cull(GLuint instanceBuffer, GLuint count, const Frustum& frustum, StreamBuffer& stream) {
+    drawLevels = 0;
+    if (lods.empty() || count == 0) return;
+    reserve(count);
+
+    // Reset the commands: every level starts empty at its own list.  They
+    // are written to the stream and copied on the GPU.
+    size_t commandBytes = lods.size() * sizeof(DrawElementsIndirectCommand);
+    StreamBuffer::Allocation staged = stream.allocate(commandBytes, sizeof(GLuint));
+    if (staged.data == nullptr) return;
+    DrawElementsIndirectCommand* commands = static_cast<DrawElementsIndirectCommand*>(staged.data);
+    for (size_t i = 0; i < lods.size(); ++i) {
+        commands[i].count = lods[i].indexCount;
+        commands[i].instanceCount = 0;
+        commands[i].firstIndex = lods[i].firstIndex;
+        commands[i].baseVertex = 0;
+        commands[i].baseInstance = (GLuint)(i * capacity);
+    }
+    glCopyNamedBufferSubData(staged.buffer, commandBuffer, staged.offset, 0, (GLsizeiptr)commandBytes);
+
+    // Cull
+    cullProgram->use();
+    for (int i = 0; i < Frustum::PLANE_COUNT; ++i) planeUniforms[i].set(frustum.planes[i]);
+    instanceCountUniform.set(count);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, instanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, visibleBuffer);
+    glDispatchCompute((count + 63) / 64, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+    glVertexArrayVertexBuffer(vao, INSTANCE_INDEX_ATTRIBUTE, visibleBuffer, 0, sizeof(GLuint));
+    if (impostorVao) glVertexArrayVertexBuffer(impostorVao, INSTANCE_INDEX_ATTRIBUTE, visibleBuffer, 0, sizeof(GLuint));
+    indirectBuffer = commandBuffer;
+    indirectOffset = 0;
+    drawLevels = (GLsizei)lods.size();
+}
+
+int AsteroidCuller::selectLod(float distance) const {
+    for (size_t i = 0; i < distances.size(); ++i) {
+        if (distance <= distances[i]) return (int)i;
+    }
+    return -1;
+}
+
+int AsteroidCuller::fadeLod(int lod, float distance) const {
+    int impostorLod = (int)lods.size() - 1;
+    if (!hasImpostors() || lod + 1 != impostorLod) return -1;
+    return distance > distances[lod] - fadeRange ? impostorLod : -1;
+}
+
+void AsteroidCuller::submit(const std::vector<GLuint>* visibleLists, StreamBuffer& stream) {
+    drawLevels = 0;
+    if (lods.empty()) return;
+
+    // The lists go back to back; each command's baseInstance is where its
+    // list starts
+    size_t total = 0;
+    for (size_t i = 0; i < lods.size(); ++i) total += visibleLists[i].size();
+    StreamBuffer::Allocation lists = stream.allocate(std::max(total, (size_t)1) * sizeof(GLuint), sizeof(GLuint));
+    StreamBuffer::Allocation staged = stream.allocate(lods.size() * sizeof(DrawElementsIndirectCommand), sizeof(GLuint));
+    if (lists.data == nullptr || staged.data == nullptr) return;
+
+    GLuint* indices = static_cast<GLuint*>(lists.data);
+    DrawElementsIndirectCommand* commands = static_cast<DrawElementsIndirectCommand*>(staged.data);
+    GLuint first = 0;
+    for (size_t i = 0; i < lods.size(); ++i) {
+        commands[i].count = lods[i].indexCount;
+        commands[i].instanceCount = (GLuint)visibleLists[i].size();
+        commands[i].firstIndex = lods[i].firstIndex;
+        commands[i].baseVertex = 0;
+        commands[i].baseInstance = first;
+        std::copy(visibleLists[i].begin(), visibleLists[i].end(), indices + first);
+        first += (GLuint)visibleLists[i].size();
+    }
+
+    glVertexArrayVertexBuffer(vao, INSTANCE_INDEX_ATTRIBUTE, lists.buffer, lists.offset, sizeof(GLuint));
+    if (impostorVao) glVertexArrayVertexBuffer(impostorVao, INSTANCE_INDEX_ATTRIBUTE, lists.buffer, lists.offset, sizeof(GLuint));
+    indirectBuffer = staged.buffer;
+    indirectOffset = staged.offset;
+    drawLevels = (GLsizei)lods.size();
+}
+
+void AsteroidCuller::draw(GLsizei firstLevel, GLsizei levelCount) {
+    levelCount = std::min(levelCount, std::min(drawLevels, (GLsizei)meshLevelCount()) - firstLevel);
+    if (levelCount <= 0) return;
+
+    // One command per level; empty levels draw nothing
+    GLintptr offset = indirectOffset + firstLevel * sizeof(DrawElementsIndirectCommand);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    GLStateCache::bindVertexArray(vao);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(offset),
+        levelCount, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void AsteroidCuller::drawImpostors() {
+    GLsizei level = (GLsizei)lods.size() - 1;
+    if (!hasImpostors() || drawLevels <= level) return;
+
+    GLintptr offset = indirectOffset + level * sizeof(DrawElementsIndirectCommand);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    GLStateCache::bindVertexArray(impostorVao);
+    glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(offset));
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
@@ -0,0 +1,100 @@
+#ifndef ASTEROID_CULLER_H
+#define ASTEROID_CULLER_H
+
+#include <vector>
+#include <glad/glad.h>
+#include "helper/glslprogram.h"
+#include "trianglemesh.h"
+#include "frustum.h"
+#include "helper/streambuffer.h"
+
+// Layout of one glMultiDrawElementsIndirect command
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// GPU culling for the asteroid field.  A compute pass (asteroid_cull.comp)
+// tests every asteroid in the instance buffer against the frustum, picks a
+// level of detail by distance and writes the survivors into one visible
+// list per level along with one indirect draw command per level.  The
+// whole field is then drawn with a single glMultiDrawElementsIndirect, and
+// the CPU work per frame does not depend on the number of asteroids.
+//
+// The visible lists reach the vertex shader as an instanced attribute
+// (InstanceIndex, location 6) rather than through gl_BaseInstance, so the
+// path only needs GL 4.3 features.
+//
+// Past the mesh levels there can be one impostor level, drawn separately
+// with its own VAO and program.  Asteroids near the end of the last mesh
+// level are listed in both, so the shaders can cross-fade them.
+class AsteroidCuller {
+public:
+    static const int MAX_LODS = 4;
+    static const GLuint INSTANCE_INDEX_ATTRIBUTE = 6;
+
+    AsteroidCuller(GLSLProgram* program);
+    ~AsteroidCuller();
+
+    // Sets the mesh levels to draw and the furthest distance each is used
+    // at; anything beyond the last distance is culled.  boundingRadius is
+    // the mesh's bounding sphere at unit scale.
+    void initialize(const TriangleMesh& mesh, const std::vector<float>& lodDistances, float boundingRadius);
+
+    // Adds the impostor level, drawn out to `distance` with `impostorVao`.
+    // The last mesh level also lists asteroids within fadeRange of its end.
+    // Call after initialize().
+    void setImpostors(GLuint impostorVao, GLuint indexCount, float distance, float fadeRange);
+    bool hasImpostors() const { return impostorVao != 0; }
+    size_t meshLevelCount() const { return hasImpostors() ? lods.size() - 1 : lods.size(); }
+
+    // Makes room for `count` asteroids
+    void reserve(size_t count);
+
+    // Culls `count` asteroids from instanceBuffer into the draw commands;
+    // the reset commands are staged in `stream`
+    void cull(GLuint instanceBuffer, GLuint count, const Frustum& frustum, StreamBuffer& stream);
+
+    // Level of detail for an asteroid at `distance` from the camera, or -1
+    // when it is too far away to draw
+    int selectLod(float distance) const;
+    size_t lodCount() const { return lods.size(); }
+
+    // Second level an asteroid at `lod` is drawn in while it cross-fades
+    // to an impostor, or -1
+    int fadeLod(int lod, float distance) const;
+
+    // Writes visible lists chosen on the CPU (one per level) and their
+    // draw commands into `stream`, in place of a cull()
+    void submit(const std::vector<GLuint>* visibleLists, StreamBuffer& stream);
+
+    // Draws the mesh levels that survived the last cull with the currently
+    // bound program; a range of levels can be drawn on its own, nearest first
+    void draw(GLsizei firstLevel = 0, GLsizei levelCount = MAX_LODS);
+
+    // Draws the impostor level with the currently bound program
+    void drawImpostors();
+
+private:
+    GLSLProgram* cullProgram;
+    GLuint vao;
+    GLuint commandBuffer;
+    GLuint visibleBuffer;
+    size_t capacity;
+    GLuint indirectBuffer;      // Where draw() reads its commands from
+    GLintptr indirectOffset;
+    GLsizei drawLevels;         // Commands for draw(), 0 when there is nothing to draw
+    std::vector<TriangleMesh::Lod> lods;
+    std::vector<float> distances;
+    float radius;
+    GLuint impostorVao;         // 0 without an impostor level
+    float fadeRange;
+
+    UniformHandle<glm::vec4> planeUniforms[Frustum::PLANE_COUNT];
+    UniformHandle<GLuint> instanceCountUniform;
+};
+
+#endif // ASTEROID_CULLER_H
@@ -0,0 +1,115 @@
+#include "AsteroidImpostors.h"
+#include "helper/glstatecache.h"
+#include <iostream>
+
+AsteroidImpostors::AsteroidImpostors(GLSLProgram* bakeProgram, GLSLProgram* program) :
+    bakeProgram(bakeProgram),
+    program(program),
+    albedoAtlas(0),
+    normalDepthAtlas(0),
+    vao(0),
+    indexBuffer(0)
+{
+}
+
+AsteroidImpostors::~AsteroidImpostors() {
+    if (albedoAtlas) glDeleteTextures(1, &albedoAtlas);
+    if (normalDepthAtlas) glDeleteTextures(1, &normalDepthAtlas);
+    if (vao) glDeleteVertexArrays(1, &vao);
+    if (indexBuffer) glDeleteBuffers(1, &indexBuffer);
+}
+
+bool AsteroidImpostors::bake(const TriangleMesh& mesh, float boundingRadius, GLuint albedoMap, GLuint normalMap) {
+    const GLsizei size = FRAMES * FRAME_SIZE;
+    const GLsizei levels = 4;   // Distant quads are small; stop before frames bleed together
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &albedoAtlas);
+    glTextureStorage2D(albedoAtlas, levels, GL_RGBA8, size, size);
+    glCreateTextures(GL_TEXTURE_2D, 1, &normalDepthAtlas);
+    glTextureStorage2D(normalDepthAtlas, levels, GL_RGBA16F, size, size);
+    for (GLuint texture : { albedoAtlas, normalDepthAtlas }) {
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    GLuint depth, fbo;
+    glCreateRenderbuffers(1, &depth);
+    glNamedRenderbufferStorage(depth, GL_DEPTH_COMPONENT24, size, size);
+    glCreateFramebuffers(1, &fbo);
+    glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0, albedoAtlas, 0);
+    glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT1, normalDepthAtlas, 0);
+    glNamedFramebufferRenderbuffer(fbo, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    const GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glNamedFramebufferDrawBuffers(fbo, 2, drawBuffers);
+
+    bool complete = glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (complete) {
+        // Uncovered texels stay at zero, which the impostor shader discards
+        const GLfloat clear[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        const GLfloat clearDepth = 1.0f;
+        glClearNamedFramebufferfv(fbo, GL_COLOR, 0, clear);
+        glClearNamedFramebufferfv(fbo, GL_COLOR, 1, clear);
+        glClearNamedFramebufferfv(fbo, GL_DEPTH, 0, &clearDepth);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        bakeProgram->use();
+        bakeProgram->uniform<float>("boundingRadius").set(boundingRadius);
+        bakeProgram->uniform<int>("albedoMap").set(0);
+        bakeProgram->uniform<int>("normalMap").set(1);
+        UniformHandle<glm::ivec2> frameUniform = bakeProgram->uniform<glm::ivec2>("frame");
+        GLStateCache::bindTexture(0, albedoMap);
+        GLStateCache::bindTexture(1, normalMap);
+
+        for (int y = 0; y < FRAMES; ++y) {
+            for (int x = 0; x < FRAMES; ++x) {
+                glViewport(x * FRAME_SIZE, y * FRAME_SIZE, FRAME_SIZE, FRAME_SIZE);
+                frameUniform.set(glm::ivec2(x, y));
+                mesh.render();
+            }
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenerateTextureMipmap(albedoAtlas);
+        glGenerateTextureMipmap(normalDepthAtlas);
+    }
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &depth);
+
+    if (!complete) {
+        std::cerr << "[ERROR] Impostor atlas framebuffer is incomplete" << std::endl;
+        glDeleteTextures(1, &albedoAtlas);
+        glDeleteTextures(1, &normalDepthAtlas);
+        albedoAtlas = normalDepthAtlas = 0;
+        return false;
+    }
+
+    // Corners 0-3 are (-1,-1), (1,-1), (-1,1), (1,1)
+    const GLuint indices[INDEX_COUNT] = { 0, 1, 2, 2, 1, 3 };
+    glCreateBuffers(1, &indexBuffer);
+    glNamedBufferStorage(indexBuffer, sizeof(indices), indices, 0);
+    glCreateVertexArrays(1, &vao);
+    glVertexArrayElementBuffer(vao, indexBuffer);
+
+    program->uniform<float>("boundingRadius").set(boundingRadius);
+    program->uniform<int>("albedoAtlas").set(0);
+    program->uniform<int>("normalDepthAtlas").set(1);
+    spinTimeUniform = program->uniform<float>("spinTime");
+
+    std::cout << "[INFO] Baked " << FRAMES * FRAMES << " asteroid impostor frames into a "
+              << size << "x" << size << " atlas" << std::endl;
+    return true;
+}
+
+void AsteroidImpostors::setFadeBand(float distance, float range) {
+    program->uniform<float>("impostorDistance").set(distance);
+    program->uniform<float>("impostorFadeRange").set(range);
+}
+
+void AsteroidImpostors::use(float spinTime) {
+    program->use();
+    spinTimeUniform.set(spinTime);
+    GLStateCache::bindTexture(0, albedoAtlas);
+    GLStateCache::bindTexture(1, normalDepthAtlas);
+}
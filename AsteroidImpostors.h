@@ -0,0 +1,62 @@
+#ifndef ASTEROID_IMPOSTORS_H
+#define ASTEROID_IMPOSTORS_H
+
+#include <string>
+#include <glad/glad.h>
+#include "helper/glslprogram.h"
+#include "trianglemesh.h"
+
+// Octahedral impostors for the far asteroid field.  At startup the
+// asteroid mesh is rendered from FRAMES x FRAMES directions, spread over
+// the sphere with an octahedral map, into an atlas: albedo with coverage
+// in alpha, plus a second texture with the object-space normal and depth.
+// Distant asteroids are then drawn as one quad each (impostor.vert/frag)
+// that picks the frame nearest the view direction, lights it with the
+// baked normal and writes the baked depth.
+//
+// The quads have no vertex buffer; the VAO holds the six indices of a
+// quad and the culler binds its visible list to InstanceIndex.
+class AsteroidImpostors {
+public:
+    static const int FRAMES = 8;           // Frames per atlas side
+    static const int FRAME_SIZE = 128;     // Pixels per frame side
+    static const GLuint INDEX_COUNT = 6;
+
+    AsteroidImpostors(GLSLProgram* bakeProgram, GLSLProgram* program);
+    ~AsteroidImpostors();
+
+    AsteroidImpostors(const AsteroidImpostors&) = delete;
+    AsteroidImpostors& operator=(const AsteroidImpostors&) = delete;
+
+    // Atlas size needed by impostor.glsl
+    template <typename Program>
+    static void defineConstants(Program& program) {
+        program.define("IMPOSTOR_FRAMES", std::to_string(FRAMES));
+    }
+
+    // Renders the atlas from the mesh's full level of detail.  Both
+    // programs must be linked.  Leaves the default framebuffer bound.
+    bool bake(const TriangleMesh& mesh, float boundingRadius, GLuint albedoMap, GLuint normalMap);
+    bool isBaked() const { return albedoAtlas != 0; }
+
+    GLuint getVao() const { return vao; }
+
+    // Camera distance the impostors are fully faded in at, and the width
+    // of the band over which they replace the mesh
+    void setFadeBand(float distance, float range);
+
+    // Binds the impostor program and atlas for this frame's draw
+    void use(float spinTime);
+
+private:
+    GLSLProgram* bakeProgram;
+    GLSLProgram* program;
+    GLuint albedoAtlas;
+    GLuint normalDepthAtlas;
+    GLuint vao;
+    GLuint indexBuffer;
+
+    UniformHandle<float> spinTimeUniform;
+};
+
+#endif // ASTEROID_IMPOSTORS_H
@@ -1,15 +1,32 @@
 #define GLM_ENABLE_EXPERIMENTAL 
 #include "Asteroid.h"
 #include "texture.h"
+#include "helper/glstatecache.h"
+#include <algorithm>
 #include <iostream>
 #include <random>
 #include <ctime>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/rotate_vector.hpp>
 
-// Constructor - initialize with shader program reference
-AsteroidManager::AsteroidManager(GLSLProgram* program) :
-    shaderProgram(program),
+// Constructor - initialize with shader program references
+AsteroidManager::AsteroidManager(const Programs& programs) :
+    shaderProgram(programs.shading),
+    fadeProgram(programs.fadeShading),
+    depthProgram(programs.depth),
+    elapsedTime(0.0f),
+    instanceBuffer(0),
+    instanceCapacity(0),
+    uploadTime(0.0f),
+    spinTime(0.0f),
+    prevSpinTime(-1.0f),
+    culler(programs.cull),
+    boundingRadius(0.0f),
+    impostors(programs.impostorBake, programs.impostor),
+    cpuCulling(false),
+    instanceGeneration(0),
+    occlusionGeneration(0),
+    occludedDraws(0),
     spawnRadius(5000.0f),
     asteroidCount(50),
     albedoMap(0),
@@ -22,12 +39,24 @@ AsteroidManager::AsteroidManager(GLSLProgram* program) :
 // Destructor - clean up resources
 AsteroidManager::~AsteroidManager() {
     clear();
+    if (instanceBuffer) glDeleteBuffers(1, &instanceBuffer);
 }
 
 // Initialize the asteroid manager with mesh and textures
 bool AsteroidManager::initialize(const std::string& meshPath,
     const std::string& albedoPath,
     const std::string& normalPath) {
+    // Resolve uniforms once; render() then sets them without name lookups
+    spinTimeUniform = shaderProgram->uniform<float>("spinTime");
+    prevSpinTimeUniform = shaderProgram->uniform<float>("prevSpinTime");
+    shaderProgram->uniform<int>("albedoMap").set(0);
+    shaderProgram->uniform<int>("normalMap").set(1);
+    fadeSpinTimeUniform = fadeProgram->uniform<float>("spinTime");
+    fadePrevSpinTimeUniform = fadeProgram->uniform<float>("prevSpinTime");
+    fadeProgram->uniform<int>("albedoMap").set(0);
+    fadeProgram->uniform<int>("normalMap").set(1);
+    depthSpinTimeUniform = depthProgram->uniform<float>("spinTime");
+
     // Load the asteroid mesh
     asteroidMesh = ObjMesh::load(meshPath.c_str(), true);
     if (!asteroidMesh) {
@@ -35,6 +64,13 @@ bool AsteroidManager::initialize(const std::string& meshPath,
         return false;
     }
 
+    // Coarser versions of the mesh for distant asteroids, then the distance
+    // each level is drawn to; asteroids past the last are not drawn
+    asteroidMesh->generateLods(LOD_LEVELS - 1);
+    Aabb meshBox = asteroidMesh->getBoundingBox();
+    boundingRadius = std::max(glm::length(meshBox.min), glm::length(meshBox.max));
+    culler.initialize(*asteroidMesh, std::vector<float>(LOD_DISTANCES, LOD_DISTANCES + LOD_LEVELS), boundingRadius);
+
     // Load textures
     albedoMap = Texture::loadTexture(albedoPath.c_str());
     if (albedoMap == GLuint(0)) {
@@ -52,9 +88,25 @@ bool AsteroidManager::initialize(const std::string& meshPath,
         std::cout << "[INFO] Asteroid normal texture loaded successfully: " << normalMap << std::endl;
     }
 
+    // Impostor atlas from the full mesh; without it the mesh levels go all
+    // the way out
+    if (impostors.bake(*asteroidMesh, boundingRadius, albedoMap, normalMap)) {
+        float fadeEnd = LOD_DISTANCES[culler.meshLevelCount() - 1];
+        culler.setImpostors(impostors.getVao(), AsteroidImpostors::INDEX_COUNT, IMPOSTOR_DISTANCE, IMPOSTOR_FADE_RANGE);
+        impostors.setFadeBand(fadeEnd, IMPOSTOR_FADE_RANGE);
+        fadeProgram->uniform<float>("impostorDistance").set(fadeEnd);
+        fadeProgram->uniform<float>("impostorFadeRange").set(IMPOSTOR_FADE_RANGE);
+        fadeProgram->uniform<float>("boundingRadius").set(boundingRadius);
+    }
+
     return true;
 }
 
+// Furthest camera distance each level of detail is drawn at
+const float AsteroidManager::LOD_DISTANCES[AsteroidManager::LOD_LEVELS] = { 3000.0f, 6000.0f, 9000.0f };
+const float AsteroidManager::IMPOSTOR_DISTANCE = 40000.0f;
+const float AsteroidManager::IMPOSTOR_FADE_RANGE = 1500.0f;
+
 // Generate a random float between min and max
 float randomFloat(float min, float max) {
     return min + static_cast<float>(rand()) / static_cast<float>(RAND_MAX / (max - min));
@@ -98,6 +150,7 @@ void AsteroidManager::generateAsteroids(const glm::vec3& centerPosition, float r
         // Add to collection
         asteroids.push_back(asteroid);
     }
+    published.reset();
 }
 
 // Add a single asteroid at a specific position
@@ -113,10 +166,12 @@ void AsteroidManager::addAsteroid(const glm::vec3& position) {
     asteroid.rotationSpeed = randomFloat(0.1f, 1.0f);
 
     asteroids.push_back(asteroid);
+    published.reset();
 }
 
 // Update asteroid rotations
 void AsteroidManager::update(float deltaTime, const glm::vec3& playerPosition) {
+    elapsedTime += deltaTime;
 
     // Update each asteroid's rotation
     for (auto& asteroid : asteroids) {
@@ -128,60 +183,203 @@ void AsteroidManager::update(float deltaTime, const glm::vec3& playerPosition) {
     }
 }
 
-// Render all asteroids
-void AsteroidManager::render(const glm::mat4& view, const glm::mat4& projection,
-    const glm::vec3& lightPos, const glm::vec3& viewPos) {
-    if (!asteroidMesh || asteroids.empty()) return;
+// Write every asteroid into the instance buffer, growing it if needed
+void AsteroidManager::uploadInstances() {
+    std::vector<AsteroidInstance> instances;
+    instances.reserve(drawn->size());
+    cpuCuller.clear();
+    cpuCuller.reserve(drawn->size());
+    for (const auto& asteroid : *drawn) {
+        float scale = std::max(asteroid.scale.x, std::max(asteroid.scale.y, asteroid.scale.z));
+        cpuCuller.add(asteroid.position, boundingRadius * scale);
+
+        AsteroidInstance instance = {};
+        instance.position = asteroid.position;
+        instance.rotationSpeed = asteroid.rotationSpeed;
+        instance.rotation = asteroid.rotation;
+        instance.scale = asteroid.scale;
+        instances.push_back(instance);
+    }
 
-    // Use the asteroid shader program
-    shaderProgram->use();
+    if (instances.size() > instanceCapacity) {
+        if (instanceBuffer) glDeleteBuffers(1, &instanceBuffer);
+        instanceCapacity = std::max(instances.size(), instanceCapacity * 2);
+        glCreateBuffers(1, &instanceBuffer);
+        glNamedBufferStorage(instanceBuffer, instanceCapacity * sizeof(AsteroidInstance), nullptr,
+            GL_DYNAMIC_STORAGE_BIT);
+    }
+    glNamedBufferSubData(instanceBuffer, 0, instances.size() * sizeof(AsteroidInstance), instances.data());
+    culler.reserve(instances.size());
 
-    // Set the view and projection matrices (these are constant for all asteroids)
-    shaderProgram->setUniform("view", view);
-    shaderProgram->setUniform("projection", projection);
+    prevSpinTime = -1.0f;       // Spin restarts at zero; no motion this frame
+    ++instanceGeneration;
+}
 
-    // Bind asteroid textures
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, albedoMap);
-    shaderProgram->setUniform("albedoMap", 0);
+// Frustum cull on the CPU, drop what the last occlusion pass found hidden,
+// then bucket the survivors by level of detail
+void AsteroidManager::cullOnCpu(const glm::mat4& viewProjection, const glm::vec3& cameraPos, StreamBuffer& stream) {
+    cpuCuller.cull(Frustum::fromMatrix(viewProjection), visibleAsteroids);
 
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, normalMap);
-    shaderProgram->setUniform("normalMap", 1);
+    // The occlusion job started last frame has had the whole frame to run
+    hiddenFlags.assign(drawn->size(), 0);
+    if (occlusionCuller.finish(hiddenAsteroids) && occlusionGeneration == instanceGeneration) {
+        for (uint32_t index : hiddenAsteroids) hiddenFlags[index] = 1;
+    }
+    startOcclusion(viewProjection, cameraPos);
+
+    occludedDraws = 0;
+    for (size_t i = 0; i < culler.lodCount(); ++i) lodLists[i].clear();
+    for (uint32_t index : visibleAsteroids) {
+        if (hiddenFlags[index]) {
+            ++occludedDraws;
+            continue;
+        }
+        const Asteroid& asteroid = (*drawn)[index];
+        float radius = boundingRadius * std::max(asteroid.scale.x, std::max(asteroid.scale.y, asteroid.scale.z));
+        float distance = std::max(glm::length(asteroid.position - cameraPos) - radius, 0.0f);
+        int lod = culler.selectLod(distance);
+        if (lod < 0) continue;
+        lodLists[lod].push_back(index);
+
+        // Also drawn as an impostor while the two cross-fade
+        int fadeLod = culler.fadeLod(lod, distance);
+        if (fadeLod >= 0) lodLists[fadeLod].push_back(index);
+    }
+    culler.submit(lodLists, stream);
+}
 
-    // Set light and camera uniforms (these are constant for all asteroids)
-    shaderProgram->setUniform("lightPos", lightPos);
-    shaderProgram->setUniform("viewPos", viewPos);
+// Queue occlusion culling of this frame's frustum-visible asteroids.  The
+// largest on screen become occluders, each as a cube well inside its rock;
+// the rest are tested with slightly grown bounds, since the result is used
+// with next frame's camera.
+void AsteroidManager::startOcclusion(const glm::mat4& viewProjection, const glm::vec3& cameraPos) {
+    const size_t MAX_OCCLUDERS = 16;
+    const float OCCLUDER_SCALE = 0.6f / 1.7320508f; // Cube in 60% of the bounding sphere
+    const float OCCLUDEE_MARGIN = 1.1f;
+
+    std::vector<std::pair<float, uint32_t>> bySize;
+    bySize.reserve(visibleAsteroids.size());
+    for (uint32_t index : visibleAsteroids) {
+        const Asteroid& asteroid = (*drawn)[index];
+        float distance = std::max(glm::length(asteroid.position - cameraPos), 1.0f);
+        bySize.emplace_back(asteroid.scale.x / distance, index);
+    }
+    size_t occluderCount = std::min(MAX_OCCLUDERS, bySize.size());
+    std::partial_sort(bySize.begin(), bySize.begin() + occluderCount, bySize.end(),
+        [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) { return a.first > b.first; });
+
+    std::vector<OcclusionCuller::OrientedBox> occluders(sceneOccluders);
+    for (size_t i = 0; i < occluderCount; ++i) {
+        const Asteroid& asteroid = (*drawn)[bySize[i].second];
+        float minScale = std::min(asteroid.scale.x, std::min(asteroid.scale.y, asteroid.scale.z));
+        float half = boundingRadius * minScale * OCCLUDER_SCALE;
+        occluders.push_back({ asteroid.position, { glm::vec3(half, 0.0f, 0.0f), glm::vec3(0.0f, half, 0.0f), glm::vec3(0.0f, 0.0f, half) } });
+    }
 
-    // Additional lighting parameters
-    shaderProgram->setUniform("lightRadius", 100.0f);
-    shaderProgram->setUniform("lightIntensity", 0.01f);
+    std::vector<OcclusionCuller::Occludee> occludees;
+    occludees.reserve(bySize.size() - occluderCount);
+    for (size_t i = occluderCount; i < bySize.size(); ++i) {
+        const Asteroid& asteroid = (*drawn)[bySize[i].second];
+        float radius = boundingRadius * std::max(asteroid.scale.x, std::max(asteroid.scale.y, asteroid.scale.z));
+        occludees.push_back({ bySize[i].second, asteroid.position, radius * OCCLUDEE_MARGIN });
+    }
 
-    // Render each asteroid
-    for (const auto& asteroid : asteroids) {
-        // Build model matrix for this asteroid
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, asteroid.position);
-        model = glm::rotate(model, asteroid.rotation.x, glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, asteroid.rotation.y, glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::rotate(model, asteroid.rotation.z, glm::vec3(0.0f, 0.0f, 1.0f));
-        model = glm::scale(model, asteroid.scale);
+    occlusionGeneration = instanceGeneration;
+    occlusionCuller.begin(viewProjection, std::move(occluders), std::move(occludees));
+}
+
+// Snapshot of the game-side state for the render side
+AsteroidManager::Frame AsteroidManager::publish() {
+    if (!published) published = std::make_shared<const std::vector<Asteroid>>(asteroids);
+    return { published, elapsedTime, cpuCulling };
+}
+
+// Pick the asteroids to draw this frame
+void AsteroidManager::cull(const Frame& frame, const glm::mat4& viewProjection, const glm::vec3& cameraPos,
+    StreamBuffer& stream) {
+    // A new list is written from the rotations it was published with
+    if (frame.asteroids != drawn) {
+        drawn = frame.asteroids;
+        uploadTime = frame.elapsedTime;
+        if (drawn && !drawn->empty()) uploadInstances();
+    }
+    if (!asteroidMesh || !drawn || drawn->empty()) return;
+    spinTime = frame.elapsedTime - uploadTime;
+
+    // Pick the visible asteroids and their levels of detail
+    if (frame.cpuCulling) {
+        cullOnCpu(viewProjection, cameraPos, stream);
+    }
+    else {
+        // Drop any occlusion result left from CPU mode; it would be stale
+        occlusionCuller.finish(hiddenAsteroids);
+        culler.cull(instanceBuffer, (GLuint)drawn->size(), Frustum::fromMatrix(viewProjection), stream);
+    }
+}
 
-        // Calculate normal matrix
-        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+// Depth of the nearby asteroids, ahead of shading
+void AsteroidManager::renderDepth() {
+    if (!asteroidMesh || !drawn || drawn->empty()) return;
 
-        // Set model-specific uniforms
-        shaderProgram->setUniform("model", model);
-        shaderProgram->setUniform("normalMatrix", normalMatrix);
+    depthProgram->use();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ASTEROID_INSTANCE_BINDING, instanceBuffer);
+    depthSpinTimeUniform.set(spinTime);
+    culler.draw(0, 1);
+}
+
+// Render all asteroids
+void AsteroidManager::render(bool depthPrepassed) {
+    if (!asteroidMesh || !drawn || drawn->empty()) return;
+
+    float drawnPrevSpinTime = prevSpinTime >= 0.0f ? prevSpinTime : spinTime;
+    prevSpinTime = spinTime;
+
+    // Use the asteroid shader program
+    shaderProgram->use();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ASTEROID_INSTANCE_BINDING, instanceBuffer);
+    spinTimeUniform.set(spinTime);
+    prevSpinTimeUniform.set(drawnPrevSpinTime);
+
+    // Bind asteroid textures (sampler units were set in initialize())
+    GLStateCache::bindTexture(0, albedoMap);
+    GLStateCache::bindTexture(1, normalMap);
+
+    // Each mesh level is one indirect draw command; the vertex shader
+    // builds each transform
+    GLsizei first = 0;
+    if (depthPrepassed) {
+        // The nearest level already has its depth; only the visible surface passes
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+        culler.draw(0, 1);
+        glDepthFunc(GL_LEQUAL);
+        glDepthMask(GL_TRUE);
+        first = 1;
+    }
+    if (!culler.hasImpostors()) {
+        culler.draw(first);
+        return;
+    }
 
-        // Render the asteroid mesh
-        asteroidMesh->render();
+    // The last mesh level dithers out as the impostors dither in
+    GLsizei fadeLevel = (GLsizei)culler.meshLevelCount() - 1;
+    culler.draw(first, fadeLevel - first);
+    if (fadeLevel >= first) {
+        fadeProgram->use();
+        fadeSpinTimeUniform.set(spinTime);
+        fadePrevSpinTimeUniform.set(drawnPrevSpinTime);
+        culler.draw(fadeLevel, 1);
     }
+
+    // Four vertices per distant asteroid
+    impostors.use(spinTime);
+    culler.drawImpostors();
 }
 
 // Clear all asteroids
 void AsteroidManager::clear() {
     asteroids.clear();
+    published.reset();
 }
 
 // Calculate bounding box for all asteroid instances
@@ -0,0 +1,75 @@
+#include "ClusteredLighting.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    const GLuint CLUSTER_COUNT = ClusteredLighting::GRID_X * ClusteredLighting::GRID_Y * ClusteredLighting::GRID_Z;
+}
+
+ClusteredLighting::ClusteredLighting(GLSLProgram* program) :
+    cullProgram(program),
+    countBuffer(0),
+    indexBuffer(0),
+    storageAlignment(256)
+{
+}
+
+ClusteredLighting::~ClusteredLighting() {
+    if (countBuffer) glDeleteBuffers(1, &countBuffer);
+    if (indexBuffer) glDeleteBuffers(1, &indexBuffer);
+}
+
+void ClusteredLighting::initialize() {
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+    if (storageAlignment < 1) storageAlignment = 1;
+
+    // Written by the cull pass and read by the lit shaders; never by the CPU
+    glCreateBuffers(1, &countBuffer);
+    glNamedBufferStorage(countBuffer, CLUSTER_COUNT * sizeof(GLuint), nullptr, 0);
+    glCreateBuffers(1, &indexBuffer);
+    glNamedBufferStorage(indexBuffer, CLUSTER_COUNT * MAX_CLUSTER_LIGHTS * sizeof(GLuint), nullptr, 0);
+
+    GLuint zero = 0;
+    glClearNamedBufferData(countBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    inverseProjectionUniform = cullProgram->uniform<glm::mat4>("inverseProjection");
+
+    std::cout << "[INFO] Clustered lighting with " << GRID_X << "x" << GRID_Y << "x" << GRID_Z
+              << " clusters, up to " << MAX_CLUSTER_LIGHTS << " lights each" << std::endl;
+}
+
+void ClusteredLighting::setupFrame(FrameData& frame, int width, int height, float nearDepth, float farDepth,
+    size_t lightCount) const {
+    float logRange = std::log(farDepth / nearDepth);
+    frame.clusterScale = glm::vec2((float)GRID_X / std::max(width, 1), (float)GRID_Y / std::max(height, 1));
+    frame.clusterDepthScale = GRID_Z / logRange;
+    frame.clusterDepthBias = -(float)GRID_Z * std::log(nearDepth) / logRange;
+    frame.lightCount = (unsigned int)std::min(lightCount, (size_t)MAX_LIGHTS);
+}
+
+void ClusteredLighting::cull(const std::vector<PointLight>& lights, const glm::mat4& projection,
+    StreamBuffer& stream) {
+    size_t count = std::min(lights.size(), (size_t)MAX_LIGHTS);
+
+    // A range binding cannot be empty, so there is always room for one light
+    size_t bytes = std::max(count, (size_t)1) * sizeof(PointLight);
+    StreamBuffer::Allocation a = stream.allocate(bytes, (size_t)storageAlignment);
+    if (a.data == nullptr) {
+        // Leave every cluster empty rather than pointing at stale lights
+        GLuint zero = 0;
+        glClearNamedBufferData(countBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        return;
+    }
+    if (count > 0) std::memcpy(a.data, lights.data(), count * sizeof(PointLight));
+
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, LIGHT_BINDING, a.buffer, a.offset, (GLsizeiptr)bytes);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_COUNT_BINDING, countBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_INDEX_BINDING, indexBuffer);
+
+    cullProgram->use();
+    inverseProjectionUniform.set(glm::inverse(projection));
+    glDispatchCompute((CLUSTER_COUNT + 63) / 64, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
@@ -0,0 +1,83 @@
+#ifndef CLUSTERED_LIGHTING_H
+#define CLUSTERED_LIGHTING_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "helper/glslprogram.h"
+#include "helper/streambuffer.h"
+#include "framedata.h"
+
+// One light in the light buffer.  The layout matches the std430 PointLight
+// struct in shader/common/clustered_lights.glsl.
+struct PointLight {
+    glm::vec3 position;        // World space
+    float range;               // No light reaches past this distance
+    glm::vec3 color;
+    float intensity;
+    float radius;              // Softens the inverse square falloff near the light
+    float padding[3];
+};
+
+static_assert(offsetof(PointLight, range) == 12, "PointLight.range must match std430");
+static_assert(offsetof(PointLight, color) == 16, "PointLight.color must match std430");
+static_assert(offsetof(PointLight, intensity) == 28, "PointLight.intensity must match std430");
+static_assert(offsetof(PointLight, radius) == 32, "PointLight.radius must match std430");
+static_assert(sizeof(PointLight) == 48, "PointLight size must match std430");
+
+// Clustered forward lighting.  The view is divided into a froxel grid of
+// GRID_X x GRID_Y screen tiles by GRID_Z depth slices, spaced
+// logarithmically between the near and far depth.  Each frame the lights
+// are written to the frame stream and a compute pass (light_cull.comp)
+// lists, per cluster, the lights whose range reaches it.  The lit shaders
+// then shade each fragment with its own cluster's lights only, so the
+// cost per pixel is capped at MAX_CLUSTER_LIGHTS however many lights the
+// scene has.
+class ClusteredLighting {
+public:
+    static const GLuint GRID_X = 16;
+    static const GLuint GRID_Y = 9;
+    static const GLuint GRID_Z = 24;
+    static const GLuint MAX_CLUSTER_LIGHTS = 64;
+    static const GLuint MAX_LIGHTS = 1024;
+
+    static const GLuint LIGHT_BINDING = 4;
+    static const GLuint CLUSTER_COUNT_BINDING = 5;
+    static const GLuint CLUSTER_INDEX_BINDING = 6;
+
+    ClusteredLighting(GLSLProgram* cullProgram);
+    ~ClusteredLighting();
+
+    // Grid sizes needed by every shader that includes clustered_lights.glsl
+    template <typename Program>
+    static void defineConstants(Program& program) {
+        program.define("CLUSTER_GRID_X", std::to_string(GRID_X));
+        program.define("CLUSTER_GRID_Y", std::to_string(GRID_Y));
+        program.define("CLUSTER_GRID_Z", std::to_string(GRID_Z));
+        program.define("MAX_CLUSTER_LIGHTS", std::to_string(MAX_CLUSTER_LIGHTS));
+    }
+
+    // Creates the cluster buffers; the cull program must be linked
+    void initialize();
+
+    // Fills the cluster fields of the frame block for a view of
+    // width x height pixels whose slices run from nearDepth to farDepth
+    void setupFrame(FrameData& frame, int width, int height, float nearDepth, float farDepth,
+        size_t lightCount) const;
+
+    // Writes the lights to the stream and assigns them to clusters.  The
+    // frame block set up for this frame must already be bound.
+    void cull(const std::vector<PointLight>& lights, const glm::mat4& projection, StreamBuffer& stream);
+
+private:
+    GLSLProgram* cullProgram;
+    GLuint countBuffer;
+    GLuint indexBuffer;
+    GLint storageAlignment;
+
+    UniformHandle<glm::mat4> inverseProjectionUniform;
+};
+
+#endif // CLUSTERED_LIGHTING_H
@@ -0,0 +1,61 @@
+#include "PostProcessing.h"
+#include "helper/bluenoise.h"
+#include "helper/glstatecache.h"
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+PostProcessing::PostProcessing(GLSLProgram* post, GLSLProgram* exposure) :
+    postProgram(post),
+    exposureProgram(exposure),
+    exposureBuffer(0),
+    blueNoiseTexture(0)
+{
+}
+
+PostProcessing::~PostProcessing() {
+    if (exposureBuffer) glDeleteBuffers(1, &exposureBuffer);
+    if (blueNoiseTexture) glDeleteTextures(1, &blueNoiseTexture);
+}
+
+void PostProcessing::initialize() {
+    // Empty histogram, then the adapted luminance and exposure it starts from
+    std::vector<GLuint> initial(HISTOGRAM_BINS + 2, 0);
+    float start[2] = { INITIAL_LUMINANCE, EXPOSURE_KEY / INITIAL_LUMINANCE };
+    std::memcpy(&initial[HISTOGRAM_BINS], start, sizeof(start));
+
+    // Read and written by the two passes only
+    glCreateBuffers(1, &exposureBuffer);
+    glNamedBufferStorage(exposureBuffer, initial.size() * sizeof(GLuint), initial.data(), 0);
+
+    blueNoiseTexture = BlueNoise::createTexture(BLUE_NOISE_SIZE);
+
+    postProgram->uniform<int>("hdrBuffer").set(0);
+    postProgram->uniform<int>("blueNoise").set(1);
+    outputSizeUniform = postProgram->uniform<glm::ivec2>("outputSize");
+    damageEffectUniform = postProgram->uniform<float>("damageEffect");
+    deltaTimeUniform = exposureProgram->uniform<float>("deltaTime");
+
+    std::cout << "[INFO] Compute post-processing with a " << HISTOGRAM_BINS << "-bin auto-exposure histogram and "
+              << BLUE_NOISE_SIZE << "x" << BLUE_NOISE_SIZE << " blue noise" << std::endl;
+}
+
+void PostProcessing::apply(GLuint hdrTexture, GLuint output, int width, int height, float damageEffect,
+    float deltaTime) {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, EXPOSURE_BINDING, exposureBuffer);
+
+    postProgram->use();
+    outputSizeUniform.set(glm::ivec2(width, height));
+    damageEffectUniform.set(damageEffect);
+    GLStateCache::bindTexture(0, hdrTexture);
+    GLStateCache::bindTexture(1, blueNoiseTexture);
+    glBindImageTexture(0, output, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    glDispatchCompute((width + TILE_SIZE - 1) / TILE_SIZE, (height + TILE_SIZE - 1) / TILE_SIZE, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // The exposure pass also clears the histogram for the next frame
+    exposureProgram->use();
+    deltaTimeUniform.set(deltaTime);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
@@ -0,0 +1,68 @@
+#ifndef POST_PROCESSING_H
+#define POST_PROCESSING_H
+
+#include <string>
+#include <glad/glad.h>
+#include "helper/glslprogram.h"
+
+// Final post-processing as compute.  One dispatch (postprocess.comp)
+// applies tint, vignette, blue noise grain, tone mapping and the damage
+// flash, and builds a luminance histogram of the frame in shared memory
+// as it goes.  A second, single-group dispatch (exposure.comp) turns the
+// histogram into a smoothed exposure for the next frame.  The histogram
+// and exposure stay in a GPU buffer, so auto-exposure adds no CPU sync
+// point; it lags the scene by one frame, which the smoothing hides.
+class PostProcessing {
+public:
+    static const GLuint TILE_SIZE = 16;
+    static const GLuint HISTOGRAM_BINS = TILE_SIZE * TILE_SIZE; // One per invocation of a group
+    static const GLuint EXPOSURE_BINDING = 7;
+    static const int BLUE_NOISE_SIZE = 64;
+
+    PostProcessing(GLSLProgram* postProgram, GLSLProgram* exposureProgram);
+    ~PostProcessing();
+
+    // Metering and adaptation constants for both programs
+    template <typename Program>
+    static void defineConstants(Program& program) {
+        program.define("POST_TILE_SIZE", std::to_string(TILE_SIZE));
+        program.define("HISTOGRAM_BINS", std::to_string(HISTOGRAM_BINS));
+        program.define("MIN_LOG_LUMINANCE", MIN_LOG_LUMINANCE);
+        program.define("LOG_LUMINANCE_RANGE", LOG_LUMINANCE_RANGE);
+        program.define("EXPOSURE_KEY", EXPOSURE_KEY);
+        program.define("MIN_EXPOSURE", MIN_EXPOSURE);
+        program.define("MAX_EXPOSURE", MAX_EXPOSURE);
+        program.define("ADAPTATION_RATE", ADAPTATION_RATE);
+    }
+
+    // Creates the exposure buffer and blue noise; the programs must be linked
+    void initialize();
+
+    // Post-processes the HDR texture into `output`, an RGBA8 texture of at
+    // least width x height, then adapts the exposure
+    void apply(GLuint hdrTexture, GLuint output, int width, int height, float damageEffect, float deltaTime);
+
+private:
+    // Metered range, in stops
+    static constexpr float MIN_LOG_LUMINANCE = -8.0f;
+    static constexpr float LOG_LUMINANCE_RANGE = 14.0f;
+
+    // The exposure is EXPOSURE_KEY over the adapted luminance, so a scene
+    // averaging 4 gets the 0.15 the fixed exposure used to be
+    static constexpr float EXPOSURE_KEY = 0.6f;
+    static constexpr float INITIAL_LUMINANCE = 4.0f;
+    static constexpr float MIN_EXPOSURE = 0.05f;
+    static constexpr float MAX_EXPOSURE = 0.45f;
+    static constexpr float ADAPTATION_RATE = 1.5f;  // Per second
+
+    GLSLProgram* postProgram;
+    GLSLProgram* exposureProgram;
+    GLuint exposureBuffer;
+    GLuint blueNoiseTexture;
+
+    UniformHandle<glm::ivec2> outputSizeUniform;
+    UniformHandle<float> damageEffectUniform;
+    UniformHandle<float> deltaTimeUniform;
+};
+
+#endif // POST_PROCESSING_H
@@ -0,0 +1,272 @@
+#include "assetcooker.h"
+#include "objmesh.h"
+#include "texturecache.h"
+#include "helper/assetarchive.h"
+#include "helper/hash.h"
+#include "helper/mappedfile.h"
+#include "helper/startupprofiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace fs = std::filesystem;
+using std::string;
+
+namespace {
+    // Bumped whenever a cooked payload format changes, so stale entries
+    // in an existing archive are cooked again instead of reused.
+    const uint64_t COOKER_VERSION = 2;
+
+    struct CookItem {
+        string name;                        // Archive key, e.g. "media/models/LPP.obj"
+        AssetArchive::AssetType type;
+        uint32_t flags = 0;
+        uint64_t contentHash = 0;
+        std::vector<unsigned char> payload;
+        bool reused = false;
+        bool failed = false;
+    };
+
+    string lowerExtension(const fs::path& p) {
+        string ext = p.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        return ext;
+    }
+
+    bool classify(const fs::path& p, AssetArchive::AssetType& type) {
+        string ext = lowerExtension(p);
+        if (ext == ".obj") {
+            type = AssetArchive::MESH;
+        } else if (ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".tga" || ext == ".bmp") {
+            type = AssetArchive::TEXTURE;
+        } else if (ext == ".vert" || ext == ".frag" || ext == ".geom" || ext == ".comp" ||
+                   ext == ".tcs" || ext == ".tes" || ext == ".vs" || ext == ".fs" ||
+                   ext == ".cs" || ext == ".gs" || ext == ".glsl") {
+            type = AssetArchive::SHADER;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // Texture::loadCubeMap reads "<base>_posx.png" etc. without flipping;
+    // every other texture is flipped for GL's bottom-up convention.
+    bool isCubeFace(const string& name) {
+        static const char* faces[] = { "_posx.", "_negx.", "_posy.", "_negy.", "_posz.", "_negz." };
+        for (const char* f : faces) {
+            if (name.find(f) != string::npos) return true;
+        }
+        return false;
+    }
+
+    void cookItem(CookItem& item, const AssetArchive& previous) {
+        StartupProfiler::AssetScope asset(item.name);
+        std::vector<unsigned char> source;
+        if (!MappedFile::readFile(item.name, source)) {
+            item.failed = true;
+            return;
+        }
+        item.contentHash = Hash::combine(Hash::bytes(source.data(), source.size()), COOKER_VERSION);
+
+        if (const AssetArchive::Entry* old = previous.find(item.name, item.type)) {
+            if (old->contentHash == item.contentHash) {
+                const unsigned char* data = previous.data(*old);
+                item.payload.assign(data, data + old->size);
+                item.flags = old->flags;
+                item.reused = true;
+                return;
+            }
+        }
+
+        switch (item.type) {
+        case AssetArchive::MESH:
+            // Cook the bytes that were hashed, so the payload always matches contentHash
+            item.failed = !ObjMesh::cookFromMemory(reinterpret_cast<const char*>(source.data()),
+                source.size(), item.payload);
+            break;
+        case AssetArchive::TEXTURE: {
+            bool flip = !isCubeFace(item.name);
+            TextureCache::Image image;
+            if (!TextureCache::loadFromMemory(source.data(), source.size(), flip, image)) {
+                item.failed = true;
+                break;
+            }
+            TextureCache::Source identity;
+            identity.hash = Hash::bytes(source.data(), source.size());
+            TextureCache::serialize(image, identity, flip, item.payload);
+            item.flags = flip ? TextureCache::FLAG_FLIPPED : 0;
+            break;
+        }
+        default:
+            item.payload.swap(source);
+            break;
+        }
+    }
+
+    uint64_t alignPage(uint64_t v) {
+        return (v + AssetArchive::PAGE_SIZE - 1) & ~uint64_t(AssetArchive::PAGE_SIZE - 1);
+    }
+
+    bool writeArchive(const string& fileName, std::vector<CookItem>& items) {
+        std::sort(items.begin(), items.end(), [](const CookItem& a, const CookItem& b) {
+            return Hash::string(a.name) < Hash::string(b.name);
+        });
+
+        std::vector<AssetArchive::Entry> toc(items.size());
+        string strings;
+        for (size_t i = 0; i < items.size(); ++i) {
+            AssetArchive::Entry& e = toc[i];
+            std::memset(&e, 0, sizeof(e));
+            e.nameHash = Hash::string(items[i].name);
+            e.nameOffset = (uint32_t)strings.size();
+            e.nameLength = (uint32_t)items[i].name.size();
+            e.type = items[i].type;
+            e.flags = items[i].flags;
+            e.size = items[i].payload.size();
+            e.contentHash = items[i].contentHash;
+            strings += items[i].name;
+        }
+
+        AssetArchive::Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "DSPK", 4);
+        header.version = AssetArchive::VERSION;
+        header.entryCount = (uint32_t)toc.size();
+        header.tocOffset = AssetArchive::PAGE_SIZE;
+        header.stringsOffset = header.tocOffset + toc.size() * sizeof(AssetArchive::Entry);
+        header.stringsSize = strings.size();
+
+        uint64_t offset = alignPage(header.stringsOffset + header.stringsSize);
+        for (auto& e : toc) {
+            e.offset = offset;
+            offset = alignPage(offset + e.size);
+        }
+
+        fs::path target(fileName);
+        std::error_code ec;
+        if (target.has_parent_path()) fs::create_directories(target.parent_path(), ec);
+        string tmpName = fileName + ".tmp";
+        {
+            std::ofstream out(tmpName, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!out) return false;
+
+            std::vector<char> page(AssetArchive::PAGE_SIZE, 0);
+            std::memcpy(page.data(), &header, sizeof(header));
+            out.write(page.data(), page.size());
+            out.write(reinterpret_cast<const char*>(toc.data()), toc.size() * sizeof(AssetArchive::Entry));
+            out.write(strings.data(), strings.size());
+
+            uint64_t written = header.stringsOffset + header.stringsSize;
+            for (size_t i = 0; i < items.size(); ++i) {
+                std::vector<char> padding((size_t)(toc[i].offset - written), 0);
+                out.write(padding.data(), padding.size());
+                out.write(reinterpret_cast<const char*>(items[i].payload.data()), items[i].payload.size());
+                written = toc[i].offset + toc[i].size;
+            }
+            std::vector<char> tail((size_t)(alignPage(written) - written), 0);
+            out.write(tail.data(), tail.size());
+            if (!out) return false;
+        }
+
+        fs::rename(tmpName, target, ec);
+        return !ec;
+    }
+}
+
+int AssetCooker::run(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if ((arg == "-o" || arg == "--output") && i + 1 < argc) {
+            options.output = argv[++i];
+        } else if ((arg == "-j" || arg == "--jobs") && i + 1 < argc) {
+            options.jobs = (unsigned int)std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--force") {
+            options.force = true;
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Usage: " << argv[0] << " [-o archive] [-j jobs] [--force] [dir ...]" << std::endl;
+            return EXIT_FAILURE;
+        } else {
+            options.roots.push_back(arg);
+        }
+    }
+    if (options.roots.empty()) options.roots = { "media", "shader" };
+
+    return cook(options) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+bool AssetCooker::cook(const Options& options) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<CookItem> items;
+    for (const string& root : options.roots) {
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+            if (!it->is_regular_file()) continue;
+            AssetArchive::AssetType type;
+            if (!classify(it->path(), type)) continue;
+
+            CookItem item;
+            item.name = AssetArchive::normalizeName(it->path().generic_string());
+            item.type = type;
+            items.push_back(std::move(item));
+        }
+        if (ec) std::cerr << "[WARNING] Unable to scan " << root << ": " << ec.message() << std::endl;
+    }
+
+    AssetArchive previous;
+    if (!options.force) previous.open(options.output);
+
+    // The cooker decodes but never populates the runtime texture cache
+    TextureCache::setEnabled(false);
+
+    unsigned int jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    std::atomic<size_t> next(0);
+    std::mutex logMutex;
+    std::vector<std::thread> workers;
+    for (unsigned int j = 0; j < jobs; ++j) {
+        workers.emplace_back([&]() {
+            for (size_t i = next++; i < items.size(); i = next++) {
+                cookItem(items[i], previous);
+                std::lock_guard<std::mutex> lock(logMutex);
+                std::cout << (items[i].failed ? "  FAILED  " : items[i].reused ? "  reused  " : "  cooked  ")
+                          << items[i].name << std::endl;
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+
+    // The archive being replaced may still be mapped
+    previous.close();
+    TextureCache::setEnabled(true);
+
+    size_t reused = 0, failed = 0;
+    uint64_t bytes = 0;
+    items.erase(std::remove_if(items.begin(), items.end(), [&](const CookItem& item) {
+        if (item.failed) ++failed;
+        return item.failed;
+    }), items.end());
+    for (const auto& item : items) {
+        if (item.reused) ++reused;
+        bytes += item.payload.size();
+    }
+
+    if (!writeArchive(options.output, items)) {
+        std::cerr << "[ERROR] Unable to write asset archive: " << options.output << std::endl;
+        return false;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Wrote " << options.output << ": " << items.size() << " assets ("
+              << (items.size() - reused) << " cooked, " << reused << " reused, " << failed << " failed), "
+              << (bytes / (1024 * 1024)) << " MB in " << seconds << " s using " << jobs << " threads" << std::endl;
+    return failed == 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Command-line cooker for the packed asset archive.
+//
+//   Project_Template.exe --cook [-o assets.pak] [-j jobs] [--force] [dir ...]
+//
+// Walks the given directories (media/ and shader/ by default), cooks every
+// mesh, texture and shader it recognises and writes one archive.  Sources
+// whose content hash matches an entry of the previous archive are copied
+// over instead of being cooked again, and the remaining work is spread
+// across a pool of worker threads.
+class AssetCooker {
+public:
+    struct Options {
+        std::string output = "assets.pak";
+        std::vector<std::string> roots;
+        unsigned int jobs = 0;      // 0 = one per hardware thread
+        bool force = false;         // Ignore the previous archive
+    };
+
+    static int run(int argc, char** argv);
+    static bool cook(const Options& options);
+};
@@ -0,0 +1,127 @@
+#include "assetpreloader.h"
+#include "objmesh.h"
+#include "helper/assetarchive.h"
+#include "helper/assetio.h"
+#include "helper/threadpool.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+using std::string;
+
+namespace {
+    std::mutex storeMutex;
+    std::map<string, std::unique_ptr<TextureCache::Image>> images;
+    std::map<string, std::vector<unsigned char>> meshes;
+
+    string imageKey(const string& fileName, bool flip) {
+        return (flip ? "1:" : "0:") + fileName;
+    }
+
+    AssetArchive::AssetType archiveType(AssetPreloader::Kind kind) {
+        switch (kind) {
+        case AssetPreloader::MESH: return AssetArchive::MESH;
+        case AssetPreloader::SHADER: return AssetArchive::SHADER;
+        default: return AssetArchive::TEXTURE;
+        }
+    }
+}
+
+void AssetPreloader::preload(const std::vector<Request>& requests) {
+    auto start = std::chrono::steady_clock::now();
+
+    // Whatever the archive already holds is served from its mapping, and
+    // textures with a current cache entry are mapped without reading them
+    std::vector<Request> wanted;
+    const AssetArchive* archive = AssetArchive::mounted();
+    for (const Request& r : requests) {
+        if (archive && archive->find(r.fileName, archiveType(r.kind))) continue;
+        if (r.kind == TEXTURE || r.kind == CUBE_FACE) {
+            bool flip = r.kind == TEXTURE;
+            std::unique_ptr<TextureCache::Image> image(new TextureCache::Image());
+            if (TextureCache::loadCached(r.fileName, flip, *image)) {
+                std::lock_guard<std::mutex> lock(storeMutex);
+                images[imageKey(r.fileName, flip)] = std::move(image);
+                continue;
+            }
+        }
+        wanted.push_back(r);
+    }
+    if (wanted.empty()) return;
+
+    std::vector<string> files;
+    for (const Request& r : wanted) files.push_back(r.fileName);
+
+    std::atomic<size_t> failed(0);
+    std::atomic<size_t> bytes(0);
+
+    ThreadPool decoders;
+    AssetIO::readBatch(files, [&](AssetIO::Result& result) {
+        const Request& r = wanted[result.index];
+        bool ok = result.ok;
+        bytes += result.data.size();
+
+        if (ok) {
+            switch (r.kind) {
+            case TEXTURE:
+            case CUBE_FACE: {
+                bool flip = r.kind == TEXTURE;
+                std::unique_ptr<TextureCache::Image> image(new TextureCache::Image());
+                ok = TextureCache::loadFromMemory(result.data.data(), result.data.size(), flip, *image, r.fileName);
+                if (ok) {
+                    std::lock_guard<std::mutex> lock(storeMutex);
+                    images[imageKey(r.fileName, flip)] = std::move(image);
+                }
+                break;
+            }
+            case MESH: {
+                std::vector<unsigned char> cooked;
+                ok = ObjMesh::cookFromMemory(reinterpret_cast<const char*>(result.data.data()),
+                    result.data.size(), cooked);
+                if (ok) {
+                    std::lock_guard<std::mutex> lock(storeMutex);
+                    meshes[r.fileName].swap(cooked);
+                }
+                break;
+            }
+            case SHADER:
+                AssetIO::stash(r.fileName, std::move(result.data));
+                break;
+            }
+        }
+        if (!ok) ++failed;
+    }, decoders);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "[INFO] Preloaded " << (wanted.size() - failed) << " of " << wanted.size() << " assets ("
+              << (bytes / 1024) << " KB) via " << AssetIO::backendName() << " and " << decoders.size()
+              << " decoder threads in " << ms << " ms" << std::endl;
+    if (failed > 0) {
+        std::cerr << "[WARNING] " << failed << " assets could not be preloaded and will load on demand" << std::endl;
+    }
+}
+
+const TextureCache::Image* AssetPreloader::image(const string& fileName, bool flip) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    auto it = images.find(imageKey(fileName, flip));
+    return it == images.end() ? nullptr : it->second.get();
+}
+
+const std::vector<unsigned char>* AssetPreloader::cookedMesh(const string& fileName) {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    auto it = meshes.find(fileName);
+    return it == meshes.end() ? nullptr : &it->second;
+}
+
+void AssetPreloader::clear() {
+    {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        images.clear();
+        meshes.clear();
+    }
+    AssetIO::clearPrefetched();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "texturecache.h"
+
+#include <string>
+#include <vector>
+
+// Reads every startup asset in one AssetIO batch and decodes each buffer on
+// a worker as soon as it lands.  Texture, ObjMesh and GLSLProgram loads then
+// pick up the decoded result instead of touching the disk again.
+//
+// Assets already present in the mounted archive are skipped; the archive is
+// faster still.  Entries stay until clear() so repeated loads of the same
+// file (the asteroid mesh and textures) are served too.
+class AssetPreloader {
+public:
+    enum Kind {
+        TEXTURE,            // Decoded and flipped, as Texture::loadTexture expects
+        CUBE_FACE,          // Decoded unflipped, as Texture::loadCubeMap expects
+        MESH,               // Parsed and cooked into ObjMesh's binary layout
+        SHADER              // Raw source text
+    };
+
+    struct Request {
+        std::string fileName;
+        Kind kind;
+    };
+
+    static void preload(const std::vector<Request>& requests);
+
+    // Decoded image for fileName, or nullptr if it was not preloaded
+    static const TextureCache::Image* image(const std::string& fileName, bool flip);
+
+    // Cooked mesh blob for fileName, or nullptr if it was not preloaded
+    static const std::vector<unsigned char>* cookedMesh(const std::string& fileName);
+
+    // Releases everything preloaded
+    static void clear();
+};
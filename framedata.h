@@ -0,0 +1,39 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// Per-frame scene data shared by every shader through the FrameData
+// uniform block (shader/common/frame_data.glsl).  The members mirror the
+// block's std140 layout: matrices are 64 bytes, and each vec3 is followed
+// by a float that fills the rest of its 16-byte slot.
+constexpr unsigned int FRAME_DATA_BINDING = 0;
+
+struct alignas(16) FrameData {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;  // Includes this frame's jitter
+    glm::mat4 prevViewProjection; // Last frame's, without jitter
+    glm::vec3 viewPos;         // Camera position in world space
+    float time;                // Seconds since start
+    glm::vec2 clusterScale;    // Light cluster tiles per pixel
+    float clusterDepthScale;   // Slice = log(view depth) * scale + bias
+    float clusterDepthBias;
+    unsigned int lightCount;   // Lights in the light buffer this frame
+    float padding0;
+    glm::vec2 jitter;          // Sub-pixel offset in NDC applied to projection
+};
+
+static_assert(offsetof(FrameData, view) == 0, "FrameData.view must match std140");
+static_assert(offsetof(FrameData, projection) == 64, "FrameData.projection must match std140");
+static_assert(offsetof(FrameData, viewProjection) == 128, "FrameData.viewProjection must match std140");
+static_assert(offsetof(FrameData, prevViewProjection) == 192, "FrameData.prevViewProjection must match std140");
+static_assert(offsetof(FrameData, viewPos) == 256, "FrameData.viewPos must match std140");
+static_assert(offsetof(FrameData, time) == 268, "FrameData.time must match std140");
+static_assert(offsetof(FrameData, clusterScale) == 272, "FrameData.clusterScale must match std140");
+static_assert(offsetof(FrameData, clusterDepthScale) == 280, "FrameData.clusterDepthScale must match std140");
+static_assert(offsetof(FrameData, clusterDepthBias) == 284, "FrameData.clusterDepthBias must match std140");
+static_assert(offsetof(FrameData, lightCount) == 288, "FrameData.lightCount must match std140");
+static_assert(offsetof(FrameData, jitter) == 296, "FrameData.jitter must match std140");
+static_assert(sizeof(FrameData) == 304, "FrameData size must match the std140 block");
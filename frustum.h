@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// View frustum as six planes (left, right, bottom, top, near, far), each
+// stored as (normal, distance) with the normal pointing inwards, so a
+// point p is inside a plane when dot(normal, p) + distance >= 0.
+struct Frustum {
+    enum { LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE, PLANE_COUNT };
+
+    glm::vec4 planes[PLANE_COUNT];
+
+    // Extracts the planes from a projection * view matrix
+    static Frustum fromMatrix(const glm::mat4& viewProjection) {
+        glm::mat4 m = glm::transpose(viewProjection);
+        Frustum f;
+        f.planes[LEFT] = m[3] + m[0];
+        f.planes[RIGHT] = m[3] - m[0];
+        f.planes[BOTTOM] = m[3] + m[1];
+        f.planes[TOP] = m[3] - m[1];
+        f.planes[NEAR_PLANE] = m[3] + m[2];
+        f.planes[FAR_PLANE] = m[3] - m[2];
+        for (glm::vec4& p : f.planes) p /= glm::length(glm::vec3(p));
+        return f;
+    }
+
+    bool intersectsSphere(const glm::vec3& center, float radius) const {
+        for (const glm::vec4& p : planes) {
+            if (glm::dot(glm::vec3(p), center) + p.w < -radius) return false;
+        }
+        return true;
+    }
+};
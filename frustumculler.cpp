@@ -0,0 +1,128 @@
+#include "frustumculler.h"
+#include "helper/cpufeatures.h"
+
+#include <chrono>
+#include <immintrin.h>
+
+namespace {
+    const size_t LANES = 8;
+
+    // Never inside: every plane test needs distance >= -radius
+    const float NEVER_VISIBLE = -3.0e38f;
+
+    // Appends base + i for every set bit i of mask
+    inline void emit(uint32_t mask, uint32_t base, std::vector<uint32_t>& visible) {
+        for (uint32_t bit = 0; mask; ++bit, mask >>= 1) {
+            if (mask & 1) visible.push_back(base + bit);
+        }
+    }
+
+    CPU_TARGET("avx")
+    void cullAvx(const float* x, const float* y, const float* z, const float* r, size_t padded,
+        const Frustum& frustum, std::vector<uint32_t>& visible) {
+        __m256 nx[Frustum::PLANE_COUNT], ny[Frustum::PLANE_COUNT], nz[Frustum::PLANE_COUNT], d[Frustum::PLANE_COUNT];
+        for (int p = 0; p < Frustum::PLANE_COUNT; ++p) {
+            nx[p] = _mm256_set1_ps(frustum.planes[p].x);
+            ny[p] = _mm256_set1_ps(frustum.planes[p].y);
+            nz[p] = _mm256_set1_ps(frustum.planes[p].z);
+            d[p] = _mm256_set1_ps(frustum.planes[p].w);
+        }
+        const __m256 zero = _mm256_setzero_ps();
+
+        for (size_t i = 0; i < padded; i += 8) {
+            __m256 cx = _mm256_loadu_ps(x + i);
+            __m256 cy = _mm256_loadu_ps(y + i);
+            __m256 cz = _mm256_loadu_ps(z + i);
+            __m256 negR = _mm256_sub_ps(zero, _mm256_loadu_ps(r + i));
+
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (int p = 0; p < Frustum::PLANE_COUNT; ++p) {
+                __m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], cx), _mm256_mul_ps(ny[p], cy)),
+                    _mm256_add_ps(_mm256_mul_ps(nz[p], cz), d[p]));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, negR, _CMP_GE_OQ));
+            }
+            emit((uint32_t)_mm256_movemask_ps(inside), (uint32_t)i, visible);
+        }
+    }
+
+    void cullSse(const float* x, const float* y, const float* z, const float* r, size_t padded,
+        const Frustum& frustum, std::vector<uint32_t>& visible) {
+        __m128 nx[Frustum::PLANE_COUNT], ny[Frustum::PLANE_COUNT], nz[Frustum::PLANE_COUNT], d[Frustum::PLANE_COUNT];
+        for (int p = 0; p < Frustum::PLANE_COUNT; ++p) {
+            nx[p] = _mm_set1_ps(frustum.planes[p].x);
+            ny[p] = _mm_set1_ps(frustum.planes[p].y);
+            nz[p] = _mm_set1_ps(frustum.planes[p].z);
+            d[p] = _mm_set1_ps(frustum.planes[p].w);
+        }
+        const __m128 zero = _mm_setzero_ps();
+
+        for (size_t i = 0; i < padded; i += 4) {
+            __m128 cx = _mm_loadu_ps(x + i);
+            __m128 cy = _mm_loadu_ps(y + i);
+            __m128 cz = _mm_loadu_ps(z + i);
+            __m128 negR = _mm_sub_ps(zero, _mm_loadu_ps(r + i));
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int p = 0; p < Frustum::PLANE_COUNT; ++p) {
+                __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)),
+                    _mm_add_ps(_mm_mul_ps(nz[p], cz), d[p]));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, negR));
+            }
+            emit((uint32_t)_mm_movemask_ps(inside), (uint32_t)i, visible);
+        }
+    }
+}
+
+FrustumCuller::FrustumCuller() : count(0), lastStats{ 0, 0, 0.0, "SSE" } {}
+
+void FrustumCuller::clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    radius.clear();
+    count = 0;
+}
+
+void FrustumCuller::reserve(size_t n) {
+    size_t padded = (n + LANES - 1) / LANES * LANES;
+    x.reserve(padded);
+    y.reserve(padded);
+    z.reserve(padded);
+    radius.reserve(padded);
+}
+
+uint32_t FrustumCuller::add(const glm::vec3& center, float r) {
+    // Overwrite the first padding slot, or grow by a block of padding
+    if (count == x.size()) {
+        x.resize(count + LANES, 0.0f);
+        y.resize(count + LANES, 0.0f);
+        z.resize(count + LANES, 0.0f);
+        radius.resize(count + LANES, NEVER_VISIBLE);
+    }
+    uint32_t index = (uint32_t)count++;
+    set(index, center, r);
+    return index;
+}
+
+void FrustumCuller::set(uint32_t index, const glm::vec3& center, float r) {
+    x[index] = center.x;
+    y[index] = center.y;
+    z[index] = center.z;
+    radius[index] = r;
+}
+
+void FrustumCuller::cull(const Frustum& frustum, std::vector<uint32_t>& visible) {
+    auto start = std::chrono::steady_clock::now();
+
+    visible.clear();
+    visible.reserve(count);
+    size_t padded = x.size();
+    bool avx = CpuFeatures::hasAvx();
+    if (avx) cullAvx(x.data(), y.data(), z.data(), radius.data(), padded, frustum, visible);
+    else cullSse(x.data(), y.data(), z.data(), radius.data(), padded, frustum, visible);
+
+    lastStats.total = count;
+    lastStats.visible = visible.size();
+    lastStats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    lastStats.path = avx ? "AVX" : "SSE";
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "frustum.h"
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Tests many bounding spheres against a frustum at once.  The spheres are
+// kept as separate x, y, z and radius arrays so eight of them (AVX) or
+// four (SSE) are tested per plane with one multiply-add chain, and the
+// indices of the visible ones are written to a list.
+class FrustumCuller {
+public:
+    struct Stats {
+        size_t total;          // Spheres tested
+        size_t visible;        // Spheres inside the frustum
+        double milliseconds;   // Time spent in the last cull
+        const char* path;      // "AVX" or "SSE"
+    };
+
+    FrustumCuller();
+
+    void clear();
+    void reserve(size_t count);
+
+    // Adds a sphere and returns its index
+    uint32_t add(const glm::vec3& center, float radius);
+    void set(uint32_t index, const glm::vec3& center, float radius);
+    size_t size() const { return count; }
+
+    // Replaces `visible` with the indices of the spheres inside the frustum
+    void cull(const Frustum& frustum, std::vector<uint32_t>& visible);
+
+    const Stats& stats() const { return lastStats; }
+
+private:
+    // Padded to a multiple of 8 with spheres that can never be visible
+    std::vector<float> x, y, z, radius;
+    size_t count;
+    Stats lastStats;
+};
@@ -0,0 +1,125 @@
+#include "assetarchive.h"
+#include "hash.h"
+#include "startupprofiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+using std::string;
+
+namespace {
+    const char PAK_MAGIC[4] = { 'D', 'S', 'P', 'K' };
+
+    // True if [offset, offset + size) lies within limit, without overflowing
+    bool inRange(uint64_t offset, uint64_t size, uint64_t limit) {
+        return offset <= limit && size <= limit - offset;
+    }
+}
+
+AssetArchive* AssetArchive::current = nullptr;
+
+bool AssetArchive::open(const string& fileName) {
+    close();
+    StartupProfiler::AssetScope asset(fileName);
+    StartupProfiler::Scope timer(StartupProfiler::OPEN);
+    if (!file.open(fileName)) return false;
+
+    Header header;
+    if (file.size() < PAGE_SIZE) {
+        close();
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, PAK_MAGIC, 4) != 0 || header.version != VERSION) {
+        std::cerr << "[WARNING] " << fileName << " is not a version " << VERSION << " asset archive" << std::endl;
+        close();
+        return false;
+    }
+    if (!inRange(header.tocOffset, (uint64_t)header.entryCount * sizeof(Entry), file.size()) ||
+        !inRange(header.stringsOffset, header.stringsSize, file.size()) ||
+        header.tocOffset % alignof(Entry) != 0) {
+        std::cerr << "[WARNING] " << fileName << " is truncated" << std::endl;
+        close();
+        return false;
+    }
+
+    // Reject the whole archive if any entry points outside the mapping, so
+    // find() and data() never hand out a range that runs off the end
+    const Entry* toc = reinterpret_cast<const Entry*>(file.data() + header.tocOffset);
+    for (uint32_t i = 0; i < header.entryCount; ++i) {
+        if (!inRange(toc[i].offset, toc[i].size, file.size()) ||
+            !inRange(toc[i].nameOffset, toc[i].nameLength, header.stringsSize)) {
+            std::cerr << "[WARNING] " << fileName << " has an out of range entry" << std::endl;
+            close();
+            return false;
+        }
+    }
+
+    entries = toc;
+    strings = reinterpret_cast<const char*>(file.data() + header.stringsOffset);
+    entryCount = header.entryCount;
+    return true;
+}
+
+void AssetArchive::close() {
+    file.close();
+    entries = nullptr;
+    strings = nullptr;
+    entryCount = 0;
+}
+
+const AssetArchive::Entry* AssetArchive::find(const string& name) const {
+    if (!isOpen()) return nullptr;
+
+    string key = normalizeName(name);
+    uint64_t h = Hash::string(key);
+    const Entry* end = entries + entryCount;
+    const Entry* it = std::lower_bound(entries, end, h,
+        [](const Entry& e, uint64_t value) { return e.nameHash < value; });
+
+    // Resolve the (unlikely) hash collisions by comparing names
+    for (; it != end && it->nameHash == h; ++it) {
+        if (it->nameLength == key.size() && std::memcmp(strings + it->nameOffset, key.data(), key.size()) == 0) {
+            return it;
+        }
+    }
+    return nullptr;
+}
+
+const AssetArchive::Entry* AssetArchive::find(const string& name, AssetType type) const {
+    const Entry* e = find(name);
+    return (e != nullptr && e->type == type) ? e : nullptr;
+}
+
+string AssetArchive::name(const Entry& entry) const {
+    return string(strings + entry.nameOffset, entry.nameLength);
+}
+
+bool AssetArchive::mount(const string& fileName) {
+    unmount();
+    AssetArchive* archive = new AssetArchive();
+    if (!archive->open(fileName)) {
+        delete archive;
+        return false;
+    }
+    current = archive;
+    std::cout << "Mounted asset archive: " << fileName << " (" << archive->size() << " assets)" << std::endl;
+    return true;
+}
+
+void AssetArchive::unmount() {
+    delete current;
+    current = nullptr;
+}
+
+const AssetArchive* AssetArchive::mounted() {
+    return current;
+}
+
+string AssetArchive::normalizeName(const string& name) {
+    string out = name;
+    std::replace(out.begin(), out.end(), '\\', '/');
+    while (out.compare(0, 2, "./") == 0) out.erase(0, 2);
+    return out;
+}
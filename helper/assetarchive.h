@@ -0,0 +1,80 @@
+#pragma once
+
+#include "mappedfile.h"
+
+#include <cstdint>
+#include <string>
+
+// Packed asset archive (.pak) read through a single memory mapping.
+//
+// Layout: a 4 KB header page, the table of contents and its string table,
+// then one payload per asset, each starting on a 4 KB boundary.  Entries are
+// keyed by their path relative to the working directory, exactly as the
+// loaders spell it (e.g. "media/textures/skybox/nebula_posx.png").
+//
+// The table of contents is sorted by name hash so lookups are a binary
+// search over the mapping.  Payloads are already cooked: meshes are in GL
+// vertex layout, textures are decoded mip chains (TextureCache format) and
+// shaders are plain source.
+class AssetArchive {
+public:
+    static const uint32_t PAGE_SIZE = 4096;
+    static const uint32_t VERSION = 2;
+
+    enum AssetType : uint32_t {
+        RAW = 0,
+        MESH = 1,
+        TEXTURE = 2,
+        SHADER = 3
+    };
+
+    struct Entry {
+        uint64_t nameHash;
+        uint32_t nameOffset;    // Into the string table
+        uint32_t nameLength;
+        uint32_t type;          // AssetType
+        uint32_t flags;         // Type specific (see TextureCache / ObjMesh)
+        uint64_t offset;        // Payload offset from the start of the file
+        uint64_t size;          // Payload size in bytes
+        uint64_t contentHash;   // Hash of the source file the payload was cooked from
+    };
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t reserved;
+        uint64_t tocOffset;
+        uint64_t stringsOffset;
+        uint64_t stringsSize;
+    };
+
+    bool open(const std::string& fileName);
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+
+    const Entry* find(const std::string& name) const;
+    const Entry* find(const std::string& name, AssetType type) const;
+    const unsigned char* data(const Entry& entry) const { return file.data() + entry.offset; }
+    std::string name(const Entry& entry) const;
+
+    uint32_t size() const { return entryCount; }
+    const Entry& entry(uint32_t i) const { return entries[i]; }
+
+    // Process-wide archive consulted by Texture, ObjMesh and GLSLProgram
+    // before they fall back to loose files.
+    static bool mount(const std::string& fileName);
+    static void unmount();
+    static const AssetArchive* mounted();
+
+    // Paths are compared with forward slashes and without a leading "./"
+    static std::string normalizeName(const std::string& name);
+
+private:
+    MappedFile file;
+    const Entry* entries = nullptr;
+    const char* strings = nullptr;
+    uint32_t entryCount = 0;
+
+    static AssetArchive* current;
+};
@@ -0,0 +1,410 @@
+#include "assetio.h"
+#include "threadpool.h"
+#include "mappedfile.h"
+#include "startupprofiler.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define ASSETIO_HAS_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using std::string;
+
+bool AssetIO::forceThreadPool = false;
+
+namespace {
+    std::mutex stashMutex;
+    std::map<string, std::vector<unsigned char>> stashed;
+
+    // Whole-file read used by the fallback path (and for files io_uring
+    // could not read).  pread() on POSIX, buffered read on Windows.
+    bool readWholeFile(const string& fileName, std::vector<unsigned char>& out) {
+#ifdef _WIN32
+        return MappedFile::readFile(fileName, out);
+#else
+        int fd;
+        struct stat info;
+        {
+            StartupProfiler::Scope timer(StartupProfiler::OPEN);
+            fd = ::open(fileName.c_str(), O_RDONLY);
+            if (fd < 0) return false;
+
+            if (fstat(fd, &info) != 0) {
+                ::close(fd);
+                return false;
+            }
+        }
+
+        StartupProfiler::Scope timer(StartupProfiler::READ);
+        out.resize((size_t)info.st_size);
+        size_t done = 0;
+        while (done < out.size()) {
+            ssize_t n = pread(fd, out.data() + done, out.size() - done, (off_t)done);
+            if (n <= 0) {
+                ::close(fd);
+                out.clear();
+                return false;
+            }
+            done += (size_t)n;
+        }
+        ::close(fd);
+        return true;
+#endif
+    }
+
+#ifdef ASSETIO_HAS_URING
+    int uringSetup(unsigned entries, io_uring_params* params) {
+        return (int)syscall(__NR_io_uring_setup, entries, params);
+    }
+
+    int uringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+    }
+
+    // Minimal io_uring instance: one submission queue, one completion queue
+    class Uring {
+    public:
+        unsigned entries = 0;
+
+        ~Uring() {
+            if (sqes) munmap(sqes, sqesSize);
+            if (cqPtr && cqPtr != sqPtr) munmap(cqPtr, cqSize);
+            if (sqPtr) munmap(sqPtr, sqSize);
+            if (fd >= 0) ::close(fd);
+        }
+
+        bool init(unsigned requested) {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            fd = uringSetup(requested, &params);
+            if (fd < 0) return false;
+
+            sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single) sqSize = cqSize = std::max(sqSize, cqSize);
+
+            sqPtr = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (sqPtr == MAP_FAILED) { sqPtr = nullptr; return false; }
+            if (single) {
+                cqPtr = sqPtr;
+            } else {
+                cqPtr = mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+                if (cqPtr == MAP_FAILED) { cqPtr = nullptr; return false; }
+            }
+            sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            void* s = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+            if (s == MAP_FAILED) return false;
+            sqes = static_cast<io_uring_sqe*>(s);
+
+            char* sq = static_cast<char*>(sqPtr);
+            sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+            sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            char* cq = static_cast<char*>(cqPtr);
+            cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+            entries = params.sq_entries;
+            return true;
+        }
+
+        // Queues a readv; the kernel sees it on the next submit()
+        void queueReadv(int file, const iovec* iov, uint64_t offset, uint64_t userData) {
+            unsigned tail = *sqTail + pendingSubmit;
+            unsigned idx = tail & sqMask;
+            io_uring_sqe* sqe = &sqes[idx];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_READV;
+            sqe->fd = file;
+            sqe->addr = (uint64_t)(uintptr_t)iov;
+            sqe->len = 1;
+            sqe->off = offset;
+            sqe->user_data = userData;
+            sqArray[idx] = idx;
+            ++pendingSubmit;
+        }
+
+        // Submits everything queued and waits for at least minComplete
+        // completions.  On failure some SQEs may still be unsubmitted().
+        bool submitAndWait(unsigned minComplete) {
+            __atomic_store_n(sqTail, *sqTail + pendingSubmit, __ATOMIC_RELEASE);
+            pendingSubmit = 0;
+            for (;;) {
+                // The kernel may take fewer SQEs than offered (and then skips
+                // the wait), so keep entering until the ring is empty
+                unsigned toSubmit = unsubmitted();
+                int ret = uringEnter(fd, toSubmit, minComplete, minComplete ? IORING_ENTER_GETEVENTS : 0);
+                if (ret < 0) {
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                if ((unsigned)ret >= toSubmit) return true;
+                if (ret == 0) return false;
+            }
+        }
+
+        // Waits for one completion without submitting anything
+        bool wait() {
+            for (;;) {
+                if (uringEnter(fd, 0, 1, IORING_ENTER_GETEVENTS) >= 0) return true;
+                if (errno != EINTR) return false;
+            }
+        }
+
+        // SQEs published to the ring that the kernel has not taken yet
+        unsigned unsubmitted() const {
+            return *sqTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+        }
+
+        template <typename F>
+        void reap(F&& handle) {
+            unsigned head = *cqHead;
+            unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            while (head != tail) {
+                const io_uring_cqe& cqe = cqes[head & cqMask];
+                handle(cqe.user_data, cqe.res);
+                ++head;
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        }
+
+    private:
+        int fd = -1;
+        void* sqPtr = nullptr;
+        void* cqPtr = nullptr;
+        size_t sqSize = 0, cqSize = 0, sqesSize = 0;
+        io_uring_sqe* sqes = nullptr;
+        unsigned* sqHead = nullptr;
+        unsigned* sqTail = nullptr;
+        unsigned* sqArray = nullptr;
+        unsigned sqMask = 0;
+        unsigned* cqHead = nullptr;
+        unsigned* cqTail = nullptr;
+        unsigned cqMask = 0;
+        io_uring_cqe* cqes = nullptr;
+        unsigned pendingSubmit = 0;
+    };
+
+    bool uringAvailable() {
+        static int available = -1;
+        if (available < 0) {
+            Uring probe;
+            available = probe.init(1) ? 1 : 0;
+        }
+        return available == 1;
+    }
+#endif
+}
+
+void AssetIO::stash(const string& fileName, std::vector<unsigned char>&& data) {
+    std::lock_guard<std::mutex> lock(stashMutex);
+    stashed[fileName] = std::move(data);
+}
+
+bool AssetIO::prefetched(const string& fileName, string& contents) {
+    std::lock_guard<std::mutex> lock(stashMutex);
+    auto it = stashed.find(fileName);
+    if (it == stashed.end()) return false;
+    contents.assign(it->second.begin(), it->second.end());
+    return true;
+}
+
+void AssetIO::clearPrefetched() {
+    std::lock_guard<std::mutex> lock(stashMutex);
+    stashed.clear();
+}
+
+AssetIO::Backend AssetIO::backend() {
+#ifdef ASSETIO_HAS_URING
+    if (!forceThreadPool && uringAvailable()) return IO_URING;
+#endif
+    return THREAD_POOL;
+}
+
+const char* AssetIO::backendName() {
+    return backend() == IO_URING ? "io_uring" : "pread thread pool";
+}
+
+void AssetIO::readBatch(const std::vector<string>& files, const Callback& onComplete, ThreadPool& decoders) {
+    if (files.empty()) return;
+    if (backend() == IO_URING && readBatchUring(files, onComplete, decoders)) return;
+    readBatchThreadPool(files, onComplete, decoders);
+}
+
+void AssetIO::readBatchThreadPool(const std::vector<string>& files, const Callback& onComplete,
+    ThreadPool& decoders) {
+    // Each job reads and then decodes, so one file's decode overlaps the
+    // other workers' reads
+    for (size_t i = 0; i < files.size(); ++i) {
+        decoders.submit([i, &files, &onComplete]() {
+            StartupProfiler::AssetScope asset(files[i]);
+            Result result;
+            result.index = i;
+            result.fileName = files[i];
+            result.ok = readWholeFile(files[i], result.data);
+            onComplete(result);
+        });
+    }
+    decoders.wait();
+}
+
+bool AssetIO::readBatchUring(const std::vector<string>& files, const Callback& onComplete,
+    ThreadPool& decoders) {
+#ifdef ASSETIO_HAS_URING
+    unsigned ringSize = 1;
+    while (ringSize < files.size() && ringSize < 256) ringSize <<= 1;
+
+    std::unique_ptr<Uring> ring(new Uring());
+    if (!ring->init(ringSize)) return false;
+
+    struct Pending {
+        int fd = -1;
+        iovec iov;
+        size_t done = 0;
+        uint64_t submitted = 0;             // First submission, for the profiler
+        std::unique_ptr<Result> result;
+    };
+    std::vector<Pending> pending(files.size());
+    std::deque<size_t> toQueue;
+
+    auto dispatch = [&](size_t i, bool ok) {
+        Pending& p = pending[i];
+        if (p.fd >= 0) ::close(p.fd);
+        p.fd = -1;
+        if (p.submitted) StartupProfiler::record(StartupProfiler::READ, files[i], p.submitted, StartupProfiler::now());
+        Result* r = p.result.release();
+        r->ok = ok;
+        if (!ok) {
+            // Retry through the plain path rather than fail the asset
+            StartupProfiler::AssetScope asset(r->fileName);
+            r->ok = readWholeFile(r->fileName, r->data);
+        }
+        decoders.submit([r, &onComplete]() {
+            std::unique_ptr<Result> owned(r);
+            StartupProfiler::AssetScope asset(owned->fileName);
+            onComplete(*owned);
+        });
+    };
+
+    // Open everything up front; the reads themselves go out in one batch
+    size_t remaining = files.size();
+    for (size_t i = 0; i < files.size(); ++i) {
+        Pending& p = pending[i];
+        p.result.reset(new Result());
+        p.result->index = i;
+        p.result->fileName = files[i];
+        p.result->ok = false;
+
+        StartupProfiler::AssetScope asset(files[i]);
+        struct stat info;
+        bool opened;
+        {
+            StartupProfiler::Scope timer(StartupProfiler::OPEN);
+            p.fd = ::open(files[i].c_str(), O_RDONLY);
+            opened = p.fd >= 0 && fstat(p.fd, &info) == 0;
+        }
+        if (!opened) {
+            dispatch(i, false);
+            --remaining;
+            continue;
+        }
+        p.result->data.resize((size_t)info.st_size);
+        if (info.st_size == 0) {
+            dispatch(i, true);
+            --remaining;
+            continue;
+        }
+        toQueue.push_back(i);
+    }
+
+    unsigned inFlight = 0;
+    auto complete = [&](uint64_t userData, int res) {
+        size_t i = (size_t)userData;
+        Pending& p = pending[i];
+        --inFlight;
+        if (res < 0) {
+            dispatch(i, false);
+            --remaining;
+            return;
+        }
+        p.done += (size_t)res;
+        if (res == 0 || p.done >= p.result->data.size()) {
+            dispatch(i, p.done >= p.result->data.size());
+            --remaining;
+        } else {
+            toQueue.push_back(i);   // Short read, queue the rest
+        }
+    };
+
+    while (remaining > 0) {
+        while (!toQueue.empty() && inFlight < ring->entries) {
+            size_t i = toQueue.front();
+            toQueue.pop_front();
+            Pending& p = pending[i];
+            if (!p.submitted) p.submitted = StartupProfiler::now();
+            p.iov.iov_base = p.result->data.data() + p.done;
+            p.iov.iov_len = p.result->data.size() - p.done;
+            ring->queueReadv(p.fd, &p.iov, p.done, i);
+            ++inFlight;
+        }
+
+        if (!ring->submitAndWait(1)) {
+            // The ring is unusable.  Reads the kernel already took still
+            // own their buffers, so reap those before the slow path reuses
+            // them; SQEs it never took are simply dropped with the ring.
+            unsigned queued = ring->unsubmitted();
+            while (inFlight > queued && ring->wait()) ring->reap(complete);
+            if (inFlight > queued) {
+                // Cannot tell when the kernel lets go: leave it the ring and
+                // the buffers, and read fresh copies instead
+                (void)ring.release();
+                std::vector<Pending>* abandoned = new std::vector<Pending>(std::move(pending));
+                pending = std::vector<Pending>(files.size());
+                for (size_t i = 0; i < files.size(); ++i) {
+                    if (!(*abandoned)[i].result) continue;
+                    pending[i].result.reset(new Result());
+                    pending[i].result->index = i;
+                    pending[i].result->fileName = files[i];
+                    (*abandoned)[i].fd = -1;
+                }
+            }
+            ring.reset();
+            for (size_t i = 0; i < pending.size(); ++i) {
+                if (pending[i].result) dispatch(i, false);
+            }
+            decoders.wait();
+            return true;
+        }
+
+        ring->reap(complete);
+    }
+
+    decoders.wait();
+    return true;
+#else
+    (void)files;
+    (void)onComplete;
+    (void)decoders;
+    return false;
+#endif
+}
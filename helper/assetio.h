@@ -0,0 +1,58 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Batched whole-file reads for startup assets.
+//
+// On Linux every read of a batch is submitted to the kernel in one
+// io_uring submission.  Where io_uring is unavailable (old kernels,
+// seccomp sandboxes, other platforms) a thread pool issues pread()s
+// instead.  Either way each completed buffer is handed to the decoder pool
+// as soon as it arrives, so parsing and decoding overlap the remaining
+// disk reads.
+class AssetIO {
+public:
+    struct Result {
+        size_t index;                       // Position in the requested list
+        std::string fileName;
+        std::vector<unsigned char> data;
+        bool ok;
+    };
+
+    // Called once per file on a decoder thread, in completion order
+    using Callback = std::function<void(Result&)>;
+
+    enum Backend {
+        IO_URING,
+        THREAD_POOL
+    };
+
+    // Reads every file and returns once all callbacks have finished
+    static void readBatch(const std::vector<std::string>& files, const Callback& onComplete,
+        ThreadPool& decoders);
+
+    // Backend the next batch will use
+    static Backend backend();
+    static const char* backendName();
+
+    // Forces the pread fallback, e.g. to compare against io_uring
+    static void setForceThreadPool(bool value) { forceThreadPool = value; }
+
+    // Raw file contents read ahead of their loader (e.g. shader sources for
+    // GLSLProgram).  Thread-safe; released with clearPrefetched().
+    static void stash(const std::string& fileName, std::vector<unsigned char>&& data);
+    static bool prefetched(const std::string& fileName, std::string& contents);
+    static void clearPrefetched();
+
+private:
+    static bool forceThreadPool;
+
+    static bool readBatchUring(const std::vector<std::string>& files, const Callback& onComplete,
+        ThreadPool& decoders);
+    static void readBatchThreadPool(const std::vector<std::string>& files, const Callback& onComplete,
+        ThreadPool& decoders);
+};
@@ -0,0 +1,120 @@
+#include "bluenoise.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+    const float SIGMA = 1.5f;           // Width of the energy filter
+    const int RADIUS = 5;               // The filter is negligible past 3 sigma
+    const float INITIAL_FILL = 0.1f;    // Fraction of pixels in the starting pattern
+
+    // Void-and-cluster state: a binary pattern and, per pixel, the sum of
+    // a Gaussian of its wrapped distance to every set pixel
+    struct Pattern {
+        int size;
+        float kernel[2 * RADIUS + 1][2 * RADIUS + 1];
+        std::vector<uint8_t> bits;
+        std::vector<float> energy;
+
+        explicit Pattern(int size) : size(size), bits(size * size, 0), energy(size * size, 0.0f) {
+            for (int dy = -RADIUS; dy <= RADIUS; ++dy) {
+                for (int dx = -RADIUS; dx <= RADIUS; ++dx) {
+                    kernel[dy + RADIUS][dx + RADIUS] = std::exp(-(float)(dx * dx + dy * dy) / (2.0f * SIGMA * SIGMA));
+                }
+            }
+        }
+
+        void set(int index, bool value) {
+            bits[index] = value;
+            float sign = value ? 1.0f : -1.0f;
+            int px = index % size;
+            int py = index / size;
+            for (int dy = -RADIUS; dy <= RADIUS; ++dy) {
+                int y = (py + dy + size) % size;
+                for (int dx = -RADIUS; dx <= RADIUS; ++dx) {
+                    int x = (px + dx + size) % size;
+                    energy[y * size + x] += sign * kernel[dy + RADIUS][dx + RADIUS];
+                }
+            }
+        }
+
+        // The set pixel with most set neighbours
+        int tightestCluster() const {
+            int best = -1;
+            for (int i = 0; i < size * size; ++i) {
+                if (bits[i] && (best < 0 || energy[i] > energy[best])) best = i;
+            }
+            return best;
+        }
+
+        // The clear pixel furthest from any set one
+        int largestVoid() const {
+            int best = -1;
+            for (int i = 0; i < size * size; ++i) {
+                if (!bits[i] && (best < 0 || energy[i] < energy[best])) best = i;
+            }
+            return best;
+        }
+    };
+}
+
+std::vector<uint8_t> BlueNoise::generate(int size, unsigned seed) {
+    const int count = size * size;
+    const int ones = std::max(1, (int)(count * INITIAL_FILL));
+
+    // Random starting pattern, then move pixels from the tightest cluster
+    // to the largest void until the pattern is evenly spread
+    Pattern prototype(size);
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> pick(0, count - 1);
+    for (int placed = 0; placed < ones;) {
+        int index = pick(random);
+        if (prototype.bits[index]) continue;
+        prototype.set(index, true);
+        ++placed;
+    }
+    for (;;) {
+        int cluster = prototype.tightestCluster();
+        prototype.set(cluster, false);
+        int gap = prototype.largestVoid();
+        prototype.set(gap, true);
+        if (gap == cluster) break;
+    }
+
+    std::vector<int> rank(count);
+
+    // Ranks below the starting pattern: take pixels out, tightest first
+    Pattern pattern = prototype;
+    for (int r = ones - 1; r >= 0; --r) {
+        int cluster = pattern.tightestCluster();
+        pattern.set(cluster, false);
+        rank[cluster] = r;
+    }
+
+    // Ranks above it: fill the largest voids until every pixel is set
+    pattern = prototype;
+    for (int r = ones; r < count; ++r) {
+        int gap = pattern.largestVoid();
+        pattern.set(gap, true);
+        rank[gap] = r;
+    }
+
+    std::vector<uint8_t> values(count);
+    for (int i = 0; i < count; ++i) values[i] = (uint8_t)(rank[i] * 256 / count);
+    return values;
+}
+
+GLuint BlueNoise::createTexture(int size, unsigned seed) {
+    std::vector<uint8_t> values = generate(size, seed);
+
+    GLuint texture;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, 1, GL_R8, size, size);
+    glTextureSubImage2D(texture, 0, 0, 0, size, size, GL_RED, GL_UNSIGNED_BYTE, values.data());
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    return texture;
+}
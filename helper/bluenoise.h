@@ -0,0 +1,18 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+// Tileable blue noise: thresholds whose neighbours differ as much as
+// possible, so dither and grain built from it show no low-frequency
+// clumps.  Generated with Ulichney's void-and-cluster method.
+namespace BlueNoise {
+    // size x size ranks spread over 0-255, row by row; size must be at
+    // least 11
+    std::vector<uint8_t> generate(int size, unsigned seed = 1);
+
+    // The same as a repeating GL_R8 texture
+    GLuint createTexture(int size, unsigned seed = 1);
+}
@@ -0,0 +1,51 @@
+#include "cpufeatures.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+    struct Features {
+        bool avx;
+        bool avx2;
+
+        Features() : avx(false), avx2(false) {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            int maxLeaf = info[0];
+            __cpuid(info, 1);
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool cpuAvx = (info[2] & (1 << 28)) != 0;
+            // The OS must save the YMM registers on context switches
+            bool osAvx = osxsave && (_xgetbv(0) & 0x6) == 0x6;
+            avx = cpuAvx && osAvx;
+            if (avx && maxLeaf >= 7) {
+                __cpuidex(info, 7, 0);
+                avx2 = (info[1] & (1 << 5)) != 0;
+            }
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+            __builtin_cpu_init();
+            avx = __builtin_cpu_supports("avx");
+            avx2 = __builtin_cpu_supports("avx2");
+#endif
+        }
+    };
+
+    const Features& features() {
+        static const Features f;
+        return f;
+    }
+}
+
+namespace CpuFeatures
+{
+    bool hasAvx() {
+        return features().avx;
+    }
+
+    bool hasAvx2() {
+        return features().avx2;
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+// Instruction sets available at run time.  SIMD paths are compiled with
+// CPU_TARGET so the executable still runs on CPUs without them, and are
+// only called when the matching check passes.
+#if defined(_MSC_VER)
+#define CPU_TARGET(isa)
+#else
+#define CPU_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace CpuFeatures
+{
+    bool hasAvx();
+    bool hasAvx2();
+}
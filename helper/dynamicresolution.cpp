@@ -0,0 +1,79 @@
+#include "dynamicresolution.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+    const float SMOOTHING = 0.2f;      // Weight of each new sample
+    const float RESPONSE = 0.25f;      // Fraction of the way to the ideal scale per sample
+    const float LOWER_BAND = 0.85f;    // Hold the scale between this fraction of the budget and the budget
+}
+
+DynamicResolution::DynamicResolution() : queries(), pending(), current(0), timing(false), target(15.0f), minScale(0.5f),
+    maxScale(1.0f), currentScale(1.0f), measured(0.0f), smoothed(0.0f), reportedScale(1.0f) {}
+
+DynamicResolution::~DynamicResolution() {
+    if (queries[0]) glDeleteQueries(QUERY_COUNT, queries);
+}
+
+void DynamicResolution::init(float targetMilliseconds, float lowest, float highest) {
+    target = targetMilliseconds;
+    maxScale = std::min(std::max(highest, 0.1f), 1.0f);
+    minScale = std::min(std::max(lowest, 0.1f), maxScale);
+    currentScale = maxScale;
+    reportedScale = maxScale;
+    glGenQueries(QUERY_COUNT, queries);
+}
+
+void DynamicResolution::beginFrame() {
+    if (queries[0] == 0) return;
+
+    // Collect every finished frame, oldest first, without waiting
+    for (int i = 1; i <= QUERY_COUNT; ++i) {
+        int slot = (current + i) % QUERY_COUNT;
+        if (!pending[slot]) continue;
+        GLint available = 0;
+        glGetQueryObjectiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &nanoseconds);
+        pending[slot] = false;
+        adjust(nanoseconds / 1.0e6f);
+    }
+
+    current = (current + 1) % QUERY_COUNT;
+    timing = !pending[current];         // Skip timing this frame if the slot is still in flight
+    if (!timing) return;
+    glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+    pending[current] = true;
+}
+
+void DynamicResolution::endFrame() {
+    if (!timing) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    timing = false;
+}
+
+int DynamicResolution::scaled(int size) const {
+    return std::max(1, (int)std::lround(size * currentScale));
+}
+
+void DynamicResolution::adjust(float milliseconds) {
+    measured = milliseconds;
+    smoothed = smoothed == 0.0f ? milliseconds : smoothed + (milliseconds - smoothed) * SMOOTHING;
+
+    if (smoothed <= target && smoothed >= target * LOWER_BAND) return;
+
+    float ideal = currentScale * std::sqrt(target * 0.5f * (1.0f + LOWER_BAND) / std::max(smoothed, 0.01f));
+    currentScale += (ideal - currentScale) * RESPONSE;
+    currentScale = std::min(std::max(currentScale, minScale), maxScale);
+
+    if (std::fabs(currentScale - reportedScale) >= 0.1f) {
+        std::cout << "[INFO] Render scale " << std::fixed << std::setprecision(2) << currentScale
+                  << " (GPU " << std::setprecision(1) << smoothed << " ms, budget " << target << " ms)"
+                  << std::defaultfloat << std::endl;
+        reportedScale = currentScale;
+    }
+}
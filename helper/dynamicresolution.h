@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Picks the fraction of the full resolution to render the scene at, so the
+// GPU keeps to a frame time budget.  Each frame is wrapped in a
+// GL_TIME_ELAPSED query; results are read a few frames later, once they
+// are available, so the CPU never waits on the GPU.  The scale moves in
+// proportion to the square root of budget / measured time (pixel cost
+// grows with the square of the scale) and is held while the time is
+// inside a band just under the budget.
+//
+// Render targets stay at full size; only the viewport shrinks, so a change
+// of scale never reallocates anything.
+class DynamicResolution {
+public:
+    DynamicResolution();
+    ~DynamicResolution();
+
+    DynamicResolution(const DynamicResolution&) = delete;
+    DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+    void init(float targetMilliseconds = 15.0f, float minScale = 0.5f, float maxScale = 1.0f);
+
+    // Brackets everything the GPU does for one frame
+    void beginFrame();
+    void endFrame();
+
+    float scale() const { return currentScale; }
+    int scaled(int size) const;
+
+    // Latest measured GPU frame time
+    float gpuMilliseconds() const { return measured; }
+
+private:
+    static const int QUERY_COUNT = 4;
+
+    GLuint queries[QUERY_COUNT];
+    bool pending[QUERY_COUNT];
+    int current;
+    bool timing;                // A query is open for this frame
+    float target;
+    float minScale;
+    float maxScale;
+    float currentScale;
+    float measured;
+    float smoothed;
+    float reportedScale;
+
+    void adjust(float milliseconds);
+};
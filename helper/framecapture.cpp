@@ -0,0 +1,190 @@
+#include "framecapture.h"
+
+#include "include/stb/stb_image_write.h"
+
+#include <algorithm>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#ifndef _WIN32
+#include <csignal>
+#endif
+
+using std::string;
+
+namespace {
+    // Local time as YYYYMMDD_HHMMSS, for file names
+    string timestamp() {
+        std::time_t now = std::time(nullptr);
+        std::tm local;
+#ifdef _WIN32
+        localtime_s(&local, &now);
+#else
+        localtime_r(&now, &local);
+#endif
+        char text[32];
+        std::strftime(text, sizeof(text), "%Y%m%d_%H%M%S", &local);
+        return text;
+    }
+
+    FILE* openPipe(const string& command) {
+#ifdef _WIN32
+        return _popen(command.c_str(), "wb");
+#else
+        return popen(command.c_str(), "w");
+#endif
+    }
+}
+
+FrameCapture::FrameCapture() : slots(), next(0), screenshotRequested(false), writer(1), queued(0), pipeFailed(false),
+    pipe(nullptr), recordWidth(0), recordHeight(0), recordedFrames(0), droppedFrames(0) {
+    // GL rows run bottom to top
+    stbi_flip_vertically_on_write(1);
+#ifndef _WIN32
+    // A pipe whose reader has gone fails the write instead of ending the process
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+}
+
+FrameCapture::~FrameCapture() {
+    // The context may already be gone; frames still on the GPU are lost
+    closePipe();
+    writer.wait();
+    for (Slot& slot : slots) {
+        if (slot.fence) glDeleteSync(slot.fence);
+        if (slot.buffer) glDeleteBuffers(1, &slot.buffer);
+    }
+}
+
+bool FrameCapture::startRecording(int width, int height, int framesPerSecond) {
+    if (pipe) return true;
+
+    string fileName = "capture_" + timestamp() + ".mp4";
+    string command = "ffmpeg -y -loglevel error -f rawvideo -pixel_format rgba -video_size " +
+        std::to_string(width) + "x" + std::to_string(height) + " -framerate " + std::to_string(framesPerSecond) +
+        " -i - -vf vflip -pix_fmt yuv420p " + fileName;
+    pipe = openPipe(command);
+    if (!pipe) {
+        std::cerr << "[ERROR] Unable to start ffmpeg for recording" << std::endl;
+        return false;
+    }
+
+    recordWidth = width;
+    recordHeight = height;
+    recordedFrames = 0;
+    droppedFrames = 0;
+    pipeFailed = false;
+    std::cout << "[INFO] Recording to " << fileName << std::endl;
+    return true;
+}
+
+void FrameCapture::stopRecording() {
+    if (!pipe) return;
+    collect(true);
+    closePipe();
+    std::cout << "[INFO] Recording stopped: " << recordedFrames << " frames written, " << droppedFrames
+              << " dropped" << std::endl;
+}
+
+void FrameCapture::closePipe() {
+    if (!pipe) return;
+    writer.wait();
+#ifdef _WIN32
+    _pclose(pipe);
+#else
+    pclose(pipe);
+#endif
+    pipe = nullptr;
+}
+
+void FrameCapture::capture(int width, int height) {
+    collect(false);
+
+    bool record = pipe && !pipeFailed && width == recordWidth && height == recordHeight;
+    if (!screenshotRequested && !record) return;
+
+    // Still in flight: skip this frame rather than wait for it
+    Slot& slot = slots[next];
+    if (slot.fence) {
+        if (record) ++droppedFrames;
+        return;
+    }
+
+    GLsizeiptr size = (GLsizeiptr)width * height * 4;
+    if (slot.size < size) {
+        if (slot.buffer) glDeleteBuffers(1, &slot.buffer);
+        glCreateBuffers(1, &slot.buffer);
+        glNamedBufferStorage(slot.buffer, size, nullptr, GL_MAP_READ_BIT | GL_CLIENT_STORAGE_BIT);
+        slot.size = size;
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    slot.width = width;
+    slot.height = height;
+    slot.screenshot = screenshotRequested ? "screenshot_" + timestamp() + ".png" : string();
+    slot.record = record;
+    screenshotRequested = false;
+    next = (next + 1) % SLOTS;
+}
+
+// Hand finished readbacks to the writer, oldest first
+void FrameCapture::collect(bool wait) {
+    for (int i = 0; i < SLOTS; ++i) {
+        Slot& slot = slots[(next + i) % SLOTS];
+        if (!slot.fence) continue;
+
+        GLenum status = wait ? glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000)
+                             : glClientWaitSync(slot.fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) break;    // Later slots are newer still
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+        if (status == GL_WAIT_FAILED) continue;
+
+        GLsizeiptr size = (GLsizeiptr)slot.width * slot.height * 4;
+        auto pixels = std::make_shared<std::vector<unsigned char>>(size);
+        if (const void* mapped = glMapNamedBufferRange(slot.buffer, 0, size, GL_MAP_READ_BIT)) {
+            std::copy_n(static_cast<const unsigned char*>(mapped), size, pixels->data());
+        }
+        glUnmapNamedBuffer(slot.buffer);
+
+        int width = slot.width;
+        int height = slot.height;
+        if (!slot.screenshot.empty()) {
+            string fileName = slot.screenshot;
+            writer.submit([pixels, width, height, fileName]() {
+                if (stbi_write_png(fileName.c_str(), width, height, 4, pixels->data(), width * 4)) {
+                    std::cout << "[INFO] Saved " << fileName << std::endl;
+                }
+                else {
+                    std::cerr << "[ERROR] Unable to write " << fileName << std::endl;
+                }
+            });
+        }
+
+        if (slot.record && pipe) {
+            if (queued >= MAX_QUEUED) {
+                ++droppedFrames;
+                continue;
+            }
+            ++queued;
+            ++recordedFrames;
+            FILE* out = pipe;
+            writer.submit([this, pixels, out]() {
+                if (!pipeFailed && fwrite(pixels->data(), 1, pixels->size(), out) != pixels->size()) {
+                    std::cerr << "[ERROR] Recording pipe closed; is ffmpeg on the PATH?" << std::endl;
+                    pipeFailed = true;
+                }
+                --queued;
+            });
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "threadpool.h"
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+
+// Screenshots and video capture of the default framebuffer without
+// stalling the pipeline.  Each captured frame is read into one of a ring
+// of pixel pack buffers and fenced; the buffer is only mapped once its
+// fence has signalled, a few frames later, so glReadPixels never waits
+// for the GPU.  The pixels then go to a background thread that encodes
+// screenshots as PNG or writes raw RGBA frames to an ffmpeg pipe.
+//
+// When every buffer is still in flight, or the writer falls behind, frames
+// are dropped from the recording rather than holding up rendering.
+class FrameCapture {
+public:
+    FrameCapture();
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // Saves the next captured frame as screenshot_<time>.png
+    void requestScreenshot() { screenshotRequested = true; }
+
+    // Pipes every frame from now on to ffmpeg, encoding capture_<time>.mp4
+    bool startRecording(int width, int height, int framesPerSecond = 60);
+
+    // Writes out the frames still in flight, then closes the pipe
+    void stopRecording();
+
+    bool isRecording() const { return pipe != nullptr; }
+
+    // Call after the last pass has drawn to the backbuffer, before the swap
+    void capture(int width, int height);
+
+private:
+    static const int SLOTS = 3;
+    static const int MAX_QUEUED = 8;    // Recorded frames the writer may fall behind by
+
+    struct Slot {
+        GLuint buffer;
+        GLsizeiptr size;
+        GLsync fence;           // Set while the readback is in flight
+        int width;
+        int height;
+        std::string screenshot; // File to save to, if any
+        bool record;
+    };
+
+    Slot slots[SLOTS];
+    int next;                   // Slot the next capture reads into
+    bool screenshotRequested;
+
+    ThreadPool writer;          // One thread, so frames reach the pipe in order
+    std::atomic<int> queued;
+    std::atomic<bool> pipeFailed;
+    FILE* pipe;
+    int recordWidth;
+    int recordHeight;
+    unsigned recordedFrames;
+    unsigned droppedFrames;
+
+    void collect(bool wait);
+    void closePipe();
+};
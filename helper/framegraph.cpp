@@ -0,0 +1,326 @@
+#include "framegraph.h"
+#include "glstatecache.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    // Frames a pooled texture may sit unused before it is freed
+    const uint64_t POOL_KEEP_FRAMES = 3;
+
+    GLenum depthAttachment(GLenum format) {
+        switch (format) {
+        case GL_DEPTH_COMPONENT16:
+        case GL_DEPTH_COMPONENT24:
+        case GL_DEPTH_COMPONENT32:
+        case GL_DEPTH_COMPONENT32F:
+            return GL_DEPTH_ATTACHMENT;
+        case GL_DEPTH24_STENCIL8:
+        case GL_DEPTH32F_STENCIL8:
+            return GL_DEPTH_STENCIL_ATTACHMENT;
+        default:
+            return GL_NONE;
+        }
+    }
+
+    // The pooled size a target of the given size is allocated at
+    FrameGraph::TextureDesc sizeClass(const FrameGraph::TextureDesc& desc) {
+        auto roundUp = [](GLsizei size) {
+            return (size + FrameGraph::SIZE_CLASS - 1) / FrameGraph::SIZE_CLASS * FrameGraph::SIZE_CLASS;
+        };
+        return { roundUp(desc.width), roundUp(desc.height), desc.format };
+    }
+
+    GLbitfield barrierBit(FrameGraph::Access access) {
+        switch (access) {
+        case FrameGraph::SAMPLED: return GL_TEXTURE_FETCH_BARRIER_BIT;
+        case FrameGraph::IMAGE: return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+        default: return GL_FRAMEBUFFER_BARRIER_BIT;
+        }
+    }
+}
+
+FrameGraph::Resource FrameGraph::Builder::create(const std::string& name, const TextureDesc& desc) {
+    ResourceNode node;
+    node.name = name;
+    node.desc = desc;
+    graph.resources.push_back(node);
+    return (Resource)graph.resources.size() - 1;
+}
+
+FrameGraph::Resource FrameGraph::Builder::read(Resource resource, Access access) {
+    graph.passes[pass].reads.push_back({ resource, access });
+    return resource;
+}
+
+FrameGraph::Resource FrameGraph::Builder::write(Resource resource, Access access) {
+    graph.passes[pass].writes.push_back({ resource, access });
+    if (graph.resources[resource].imported) graph.passes[pass].sideEffect = true;
+    return resource;
+}
+
+FrameGraph::FrameGraph() : frame(0) {}
+
+FrameGraph::~FrameGraph() {
+    for (const auto& f : framebuffers) glDeleteFramebuffers(1, &f.second);
+    for (const PooledTexture& t : pool) glDeleteTextures(1, &t.texture);
+}
+
+FrameGraph::Resource FrameGraph::importBackbuffer(const std::string& name, GLsizei width, GLsizei height) {
+    ResourceNode node;
+    node.name = name;
+    node.desc = { width, height, GL_NONE };
+    node.imported = true;
+    resources.push_back(node);
+    return (Resource)resources.size() - 1;
+}
+
+FrameGraph::Resource FrameGraph::importTexture(const std::string& name, GLuint texture, const TextureDesc& desc) {
+    ResourceNode node;
+    node.name = name;
+    node.desc = desc;
+    node.imported = true;
+    node.external = texture;
+    resources.push_back(node);
+    return (Resource)resources.size() - 1;
+}
+
+void FrameGraph::forgetTexture(GLuint texture) {
+    for (auto it = framebuffers.begin(); it != framebuffers.end();) {
+        if (std::find(it->first.begin(), it->first.end(), texture) != it->first.end()) {
+            glDeleteFramebuffers(1, &it->second);
+            it = framebuffers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void FrameGraph::addPass(const std::string& name, const Setup& setup, Execute execute) {
+    Pass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    passes.push_back(std::move(pass));
+
+    Builder builder(*this, (int)passes.size() - 1);
+    setup(builder);
+}
+
+GLuint FrameGraph::texture(Resource resource) const {
+    if (resources[resource].imported) return resources[resource].external;
+    int physical = resources[resource].physical;
+    return physical < 0 ? 0 : pool[physical].texture;
+}
+
+const FrameGraph::TextureDesc& FrameGraph::desc(Resource resource) const {
+    return resources[resource].desc;
+}
+
+const FrameGraph::TextureDesc& FrameGraph::storage(Resource resource) const {
+    int physical = resources[resource].physical;
+    return physical < 0 ? resources[resource].desc : pool[physical].desc;
+}
+
+void FrameGraph::execute() {
+    ++frame;
+    cull();
+    computeLifetimes();
+
+    for (int i = 0; i < (int)passes.size(); ++i) {
+        Pass& pass = passes[i];
+        if (!pass.sideEffect && pass.refCount == 0) continue;
+
+        for (const auto* uses : { &pass.reads, &pass.writes }) {
+            for (const Use& use : *uses) {
+                ResourceNode& r = resources[use.resource];
+                if (!r.imported && r.firstUse == i && r.physical < 0) r.physical = acquire(r.desc);
+            }
+        }
+
+        barrier(pass);
+        bindFramebuffer(pass);
+        pass.execute(*this);
+
+        // Image stores are not coherent with anything that follows
+        for (const Use& use : pass.writes) {
+            int physical = resources[use.resource].physical;
+            if (use.access == IMAGE && physical >= 0) {
+                pool[physical].unsynced = GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT |
+                    GL_FRAMEBUFFER_BARRIER_BIT;
+            }
+        }
+
+        // Targets whose last use was this pass hand their texture back
+        for (const auto* uses : { &pass.reads, &pass.writes }) {
+            for (const Use& use : *uses) {
+                ResourceNode& r = resources[use.resource];
+                if (r.physical >= 0 && r.lastUse == i) {
+                    pool[r.physical].inUse = false;
+                    r.physical = -1;
+                }
+            }
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    trimPool();
+    passes.clear();
+    resources.clear();
+}
+
+void FrameGraph::cull() {
+    for (Pass& pass : passes) {
+        pass.refCount = (int)pass.writes.size();
+        for (const Use& use : pass.reads) resources[use.resource].refCount++;
+    }
+
+    // Start from the targets nobody reads and walk back through their writers
+    std::vector<Resource> unused;
+    for (Resource r = 0; r < (Resource)resources.size(); ++r) {
+        if (resources[r].refCount == 0) unused.push_back(r);
+    }
+
+    auto release = [&](Pass& pass) {
+        for (const Use& use : pass.reads) {
+            if (--resources[use.resource].refCount == 0) unused.push_back(use.resource);
+        }
+    };
+
+    // Passes that write nothing have no consumer either
+    for (Pass& pass : passes) {
+        if (pass.writes.empty() && !pass.sideEffect) release(pass);
+    }
+
+    while (!unused.empty()) {
+        Resource r = unused.back();
+        unused.pop_back();
+        for (Pass& pass : passes) {
+            if (pass.sideEffect || pass.refCount == 0) continue;
+            bool writes = std::any_of(pass.writes.begin(), pass.writes.end(),
+                [r](const Use& use) { return use.resource == r; });
+            if (writes && --pass.refCount == 0) release(pass);
+        }
+    }
+}
+
+void FrameGraph::computeLifetimes() {
+    for (int i = 0; i < (int)passes.size(); ++i) {
+        const Pass& pass = passes[i];
+        if (!pass.sideEffect && pass.refCount == 0) continue;
+        for (const auto* uses : { &pass.reads, &pass.writes }) {
+            for (const Use& use : *uses) {
+                ResourceNode& r = resources[use.resource];
+                if (r.firstUse < 0) r.firstUse = i;
+                r.lastUse = i;
+            }
+        }
+    }
+}
+
+void FrameGraph::barrier(const Pass& pass) {
+    GLbitfield bits = 0;
+    for (const auto* uses : { &pass.reads, &pass.writes }) {
+        for (const Use& use : *uses) {
+            int physical = resources[use.resource].physical;
+            if (physical >= 0) bits |= pool[physical].unsynced & barrierBit(use.access);
+        }
+    }
+    if (bits == 0) return;
+
+    // One barrier covers every texture, not just the ones this pass uses
+    glMemoryBarrier(bits);
+    for (PooledTexture& t : pool) t.unsynced &= ~bits;
+}
+
+void FrameGraph::bindFramebuffer(const Pass& pass) {
+    std::vector<GLuint> colors;
+    GLuint depth = 0;
+    GLenum depthPoint = GL_NONE;
+    const TextureDesc* size = nullptr;
+
+    for (const Use& use : pass.writes) {
+        if (use.access != ATTACHMENT) continue;
+        const ResourceNode& r = resources[use.resource];
+        size = &r.desc;
+        if (r.imported && r.external == 0) {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, r.desc.width, r.desc.height);
+            return;
+        }
+        GLenum point = depthAttachment(r.desc.format);
+        if (point != GL_NONE) {
+            depth = texture(use.resource);
+            depthPoint = point;
+        } else {
+            colors.push_back(texture(use.resource));
+        }
+    }
+    if (size == nullptr) return;       // Compute-only pass
+
+    std::vector<GLuint> key = colors;
+    key.push_back(depth);
+
+    GLuint& fbo = framebuffers[key];
+    if (fbo == 0) {
+        glCreateFramebuffers(1, &fbo);
+        std::vector<GLenum> drawBuffers;
+        for (size_t i = 0; i < colors.size(); ++i) {
+            glNamedFramebufferTexture(fbo, GL_COLOR_ATTACHMENT0 + (GLenum)i, colors[i], 0);
+            drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + (GLenum)i);
+        }
+        if (depth != 0) glNamedFramebufferTexture(fbo, depthPoint, depth, 0);
+        if (drawBuffers.empty()) glNamedFramebufferDrawBuffer(fbo, GL_NONE);
+        else glNamedFramebufferDrawBuffers(fbo, (GLsizei)drawBuffers.size(), drawBuffers.data());
+
+        if (glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "[ERROR] Framebuffer for pass '" << pass.name << "' is not complete" << std::endl;
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, size->width, size->height);
+}
+
+int FrameGraph::acquire(const TextureDesc& target) {
+    TextureDesc desc = sizeClass(target);
+    for (int i = 0; i < (int)pool.size(); ++i) {
+        if (!pool[i].inUse && pool[i].desc == desc) {
+            pool[i].inUse = true;
+            pool[i].lastFrame = frame;
+            return i;
+        }
+    }
+
+    GLuint texture;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, 1, desc.format, desc.width, desc.height);
+    GLint filter = depthAttachment(desc.format) != GL_NONE ? GL_NEAREST : GL_LINEAR;
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, filter);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, filter);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    pool.push_back({ texture, desc, true, frame, 0 });
+    std::cout << "[INFO] Frame graph allocated a " << desc.width << "x" << desc.height
+              << " target (" << pool.size() << " pooled)" << std::endl;
+    return (int)pool.size() - 1;
+}
+
+void FrameGraph::trimPool() {
+    bool freed = false;
+    for (size_t i = 0; i < pool.size();) {
+        if (pool[i].inUse || frame - pool[i].lastFrame <= POOL_KEEP_FRAMES) {
+            ++i;
+            continue;
+        }
+
+        GLuint texture = pool[i].texture;
+        forgetTexture(texture);
+        glDeleteTextures(1, &texture);
+        pool.erase(pool.begin() + i);
+        freed = true;
+    }
+
+    // A freed name may be reused by the next texture created
+    if (freed) GLStateCache::invalidate();
+}
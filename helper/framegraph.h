@@ -0,0 +1,143 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// Render passes for one frame, declared with the targets they read and
+// write and then run in one go.  The graph is rebuilt every frame:
+//
+//  - Passes whose outputs nothing reads are dropped, unless they write an
+//    imported target such as the backbuffer.
+//  - Transient targets only exist from the first pass that uses them to
+//    the last.  Their textures come from a pool, so targets with the same
+//    size class and format whose lifetimes do not overlap share one
+//    texture.  Pooled textures have immutable storage, with each dimension
+//    rounded up to a multiple of SIZE_CLASS, so a resize that stays in the
+//    same class reuses them; a texture may be larger than its target.
+//    Textures left unused for a few frames (after a resize, say) are freed.
+//  - Each pass draws into a framebuffer built from the targets it writes
+//    as attachments; the framebuffers are cached.
+//  - A memory barrier is issued only where a pass uses a target an
+//    earlier pass wrote with image stores.  Attachment writes need none in
+//    GL once the framebuffer changes.
+class FrameGraph {
+public:
+    using Resource = int;
+
+    // Granularity of pooled texture sizes
+    static const GLsizei SIZE_CLASS = 128;
+
+    enum Access {
+        ATTACHMENT,     // Colour or depth attachment of the pass framebuffer
+        SAMPLED,        // Read through a sampler
+        IMAGE           // Image load/store
+    };
+
+    struct TextureDesc {
+        GLsizei width;
+        GLsizei height;
+        GLenum format;  // Sized internal format
+
+        bool operator==(const TextureDesc& o) const {
+            return width == o.width && height == o.height && format == o.format;
+        }
+    };
+
+    class Builder {
+    public:
+        Resource create(const std::string& name, const TextureDesc& desc);
+        Resource read(Resource resource, Access access = SAMPLED);
+        Resource write(Resource resource, Access access = ATTACHMENT);
+
+    private:
+        friend class FrameGraph;
+        Builder(FrameGraph& graph, int pass) : graph(graph), pass(pass) {}
+        FrameGraph& graph;
+        int pass;
+    };
+
+    using Setup = std::function<void(Builder&)>;
+    using Execute = std::function<void(const FrameGraph&)>;
+
+    FrameGraph();
+    ~FrameGraph();
+
+    FrameGraph(const FrameGraph&) = delete;
+    FrameGraph& operator=(const FrameGraph&) = delete;
+
+    // The default framebuffer; writing it keeps a pass alive
+    Resource importBackbuffer(const std::string& name, GLsizei width, GLsizei height);
+
+    // A texture owned outside the graph that lives across frames, such as
+    // a history buffer; writing it keeps a pass alive
+    Resource importTexture(const std::string& name, GLuint texture, const TextureDesc& desc);
+
+    // Drops cached framebuffers that use an imported texture about to be deleted
+    void forgetTexture(GLuint texture);
+
+    // The setup callback runs immediately; execute runs in execute()
+    void addPass(const std::string& name, const Setup& setup, Execute execute);
+
+    // Culls, allocates and runs the passes in order, then clears the graph
+    void execute();
+
+    // Valid while the pass that uses the resource is running
+    GLuint texture(Resource resource) const;
+    const TextureDesc& desc(Resource resource) const;
+
+    // Size of the texture behind the resource, which for pooled targets
+    // may exceed desc(); needed to turn target pixels into texture UVs
+    const TextureDesc& storage(Resource resource) const;
+
+private:
+    struct Use {
+        Resource resource;
+        Access access;
+    };
+
+    struct Pass {
+        std::string name;
+        Execute execute;
+        std::vector<Use> reads;
+        std::vector<Use> writes;
+        bool sideEffect = false;    // Writes an imported target
+        int refCount = 0;
+    };
+
+    struct ResourceNode {
+        std::string name;
+        TextureDesc desc;
+        bool imported = false;
+        GLuint external = 0;        // Imported texture; 0 for the backbuffer
+        int refCount = 0;
+        int firstUse = -1;
+        int lastUse = -1;
+        int physical = -1;          // Index into pool while alive
+    };
+
+    struct PooledTexture {
+        GLuint texture;
+        TextureDesc desc;
+        bool inUse;
+        uint64_t lastFrame;
+        GLbitfield unsynced;        // Barrier bits owed since an image store
+    };
+
+    std::vector<Pass> passes;
+    std::vector<ResourceNode> resources;
+    std::vector<PooledTexture> pool;
+    std::map<std::vector<GLuint>, GLuint> framebuffers;
+    uint64_t frame;
+
+    void cull();
+    void computeLifetimes();
+    void barrier(const Pass& pass);
+    void bindFramebuffer(const Pass& pass);
+    int acquire(const TextureDesc& target);
+    void trimPool();
+};
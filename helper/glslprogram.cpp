@@ -1,6 +1,13 @@
 #include "glslprogram.h"
 #include "glutils.h"
+#include "glstatecache.h"
+#include "shaderpreprocessor.h"
+#include "startupprofiler.h"
+#include "hash.h"
+#include "mappedfile.h"
+#include <cstring>
 #include <fstream>
+#include <iostream>
 
 using std::ifstream;
 using std::ios;
@@ -28,17 +35,78 @@ namespace GLSLShaderInfo {
 		{"_frag.glsl", GLSLShader::FRAGMENT},
 		{".frag.glsl", GLSLShader::FRAGMENT},
 		{".cs",   GLSLShader::COMPUTE},
+		{".comp", GLSLShader::COMPUTE},
 		{ ".cs.glsl",   GLSLShader::COMPUTE }
 	};
 }
 
-GLSLProgram::GLSLProgram() : handle(0), linked(false) {}
+namespace {
+    // Linked programs are cached as cache/programs/<key>.bin
+    const char PROGRAM_BINARY_DIRECTORY[] = "cache/programs";
+    const char PROGRAM_BINARY_MAGIC[4] = { 'D', 'S', 'P', 'B' };
+    const uint32_t PROGRAM_BINARY_VERSION = 1;
+
+    struct ProgramBinaryHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint32_t format;                    // As returned by glGetProgramBinary
+        uint32_t length;                    // Bytes following the header
+    };
+
+    string binaryPath(uint64_t key) {
+        return string(PROGRAM_BINARY_DIRECTORY) + "/" + Hash::toHex(key) + ".bin";
+    }
+
+    bool binariesSupported() {
+        static GLint formats = -1;
+        if (formats < 0) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    // A binary is only valid for the exact driver that produced it
+    uint64_t driverHash() {
+        static uint64_t hash = 0;
+        if (hash == 0) {
+            hash = Hash::SEED;
+            for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION }) {
+                const char *value = reinterpret_cast<const char *>(glGetString(name));
+                hash = Hash::string(value ? value : "", hash);
+            }
+        }
+        return hash;
+    }
+
+    // GL_KHR_parallel_shader_compile is not in the generated loader, so the
+    // entry point is fetched by hand.  Once enabled, compiles issued
+    // back-to-back run on driver threads until their status is queried.
+    typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+    void enableParallelCompile() {
+        static bool checked = false;
+        if (checked) return;
+        checked = true;
+
+        const char *entry = nullptr;
+        if (GLUtils::hasExtension("GL_KHR_parallel_shader_compile")) entry = "glMaxShaderCompilerThreadsKHR";
+        else if (GLUtils::hasExtension("GL_ARB_parallel_shader_compile")) entry = "glMaxShaderCompilerThreadsARB";
+        if (entry == nullptr) return;
+
+        auto maxThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(GLUtils::getProcAddress(entry));
+        if (maxThreads == nullptr) return;
+        maxThreads(0xFFFFFFFFu);            // Let the driver pick
+        std::cout << "[INFO] Parallel shader compilation enabled" << std::endl;
+    }
+}
+
+GLSLProgram::GLSLProgram() : handle(0), linked(false), linkIssued(false), binaryKey(0) {}
 
 GLSLProgram::~GLSLProgram() {
     if (handle == 0) return;
 	detachAndDeleteShaderObjects();
     // Delete the program
     glDeleteProgram(handle);
+    GLStateCache::invalidate();     // The name may be reused
 }
 
 void GLSLProgram::detachAndDeleteShaderObjects() {
@@ -94,11 +162,23 @@ string GLSLProgram::getExtension(const char *name) {
 
 void GLSLProgram::compileShader(const char *fileName,
                                 GLSLShader::GLSLShaderType type) {
-    if (!fileExists(fileName)) {
+    StartupProfiler::AssetScope asset(fileName);
+
+    // Archive, startup prefetch or loose file, in that order
+    string source;
+    if (!ShaderPreprocessor::readFile(fileName, source)) {
         string message = string("Shader: ") + fileName + " not found.";
         throw GLSLProgramException(message);
     }
 
+    compileShader(source, type, fileName);
+}
+
+void GLSLProgram::compileShader(const string &source,
+                                GLSLShader::GLSLShaderType type,
+                                const char *fileName) {
+    if (linked || linkIssued) throw GLSLProgramException("Program has already been linked.");
+
     if (handle <= 0) {
         handle = glCreateProgram();
         if (handle == 0) {
@@ -106,96 +186,208 @@ void GLSLProgram::compileShader(const char *fileName,
         }
     }
 
-    ifstream inFile(fileName, ios::in);
-    if (!inFile) {
-        string message = string("Unable to open: ") + fileName;
-        throw GLSLProgramException(message);
+    if (fileName) {
+        if (!programName.empty()) programName += "+";
+        programName += fileName;
     }
 
-    // Get file contents
-    std::stringstream code;
-    code << inFile.rdbuf();
-    inFile.close();
-
-    compileShader(code.str(), type, fileName);
+    // Compilation is deferred to link() so a cached binary can skip it
+    ShaderSource s;
+    s.type = type;
+    s.fileName = fileName ? string(fileName) : string();
+    s.source = ShaderPreprocessor::process(source, s.fileName, defines, &s.files);
+    s.shader = 0;
+    sources.push_back(std::move(s));
 }
 
-void GLSLProgram::compileShader(const string &source,
-                                GLSLShader::GLSLShaderType type,
-                                const char *fileName) {
-    if (handle <= 0) {
-        handle = glCreateProgram();
-        if (handle == 0) {
-            throw GLSLProgramException("Unable to create shader program.");
+void GLSLProgram::define(const string &name, const string &value) {
+    if (linked || linkIssued) throw GLSLProgramException("Program has already been linked.");
+    for (auto &d : defines) {
+        if (d.first == name) {
+            d.second = value;
+            return;
         }
     }
+    defines.emplace_back(name, value);
+}
 
-    GLuint shaderHandle = glCreateShader(type);
+void GLSLProgram::define(const string &name, float value) {
+    // Always spell floats with a decimal point so GLSL types them as float
+    std::ostringstream text;
+    text.precision(9);
+    text << std::showpoint << value;
+    define(name, text.str());
+}
 
-    const char *c_code = source.c_str();
-    glShaderSource(shaderHandle, 1, &c_code, NULL);
+void GLSLProgram::linkAsync() {
+    if (linked || linkIssued) return;
+    if (handle <= 0) throw GLSLProgramException("Program has not been compiled.");
 
-    // Compile the shader
-    glCompileShader(shaderHandle);
+    StartupProfiler::AssetScope asset(programName);
 
-    // Check for errors
-    int result;
-    glGetShaderiv(shaderHandle, GL_COMPILE_STATUS, &result);
-    if (GL_FALSE == result) {
-        // Compile failed, get log
-		std::string msg;
-		if (fileName) {
-			msg = string(fileName) + ": shader compliation failed\n";
-		}
-		else {
-			msg = "Shader compilation failed.\n";
-		}
+    // Key on every source plus the driver that will consume the binary
+    binaryKey = Hash::combine(driverHash(), PROGRAM_BINARY_VERSION);
+    for (const ShaderSource &s : sources) {
+        binaryKey = Hash::combine(binaryKey, (uint64_t)s.type);
+        binaryKey = Hash::string(s.source, binaryKey);
+    }
+    if (loadBinary()) {
+        sources.clear();
+        findUniformLocations();
+        linked = true;
+        return;
+    }
 
-        int length = 0;
-        glGetShaderiv(shaderHandle, GL_INFO_LOG_LENGTH, &length);
-        if (length > 0) {
-            std::string log(length, ' ');
-            int written = 0;
-            glGetShaderInfoLog(shaderHandle, length, &written, &log[0]);
-			msg += log;
+    enableParallelCompile();
+
+    // Issue every compile before querying any status, so a driver with
+    // parallel compilation enabled can work on them concurrently
+    {
+        StartupProfiler::Scope timer(StartupProfiler::COMPILE);
+        for (ShaderSource &s : sources) {
+            s.shader = glCreateShader(s.type);
+            const char *c_code = s.source.c_str();
+            glShaderSource(s.shader, 1, &c_code, NULL);
+            glCompileShader(s.shader);
+            glAttachShader(handle, s.shader);
         }
-        throw GLSLProgramException(msg);
-    } else {
-        // Compile succeeded, attach shader
-        glAttachShader(handle, shaderHandle);
     }
+
+    StartupProfiler::Scope timer(StartupProfiler::LINK);
+    if (binariesSupported()) glProgramParameteri(handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(handle);
+    linkIssued = true;
 }
 
 void GLSLProgram::link() {
     if (linked) return;
-    if (handle <= 0) throw GLSLProgramException("Program has not been compiled.");
+    if (!linkIssued) linkAsync();
+    if (linked) return;
 
-    glLinkProgram(handle);
+    // The status query is where the driver is waited on
+    StartupProfiler::AssetScope asset(programName);
 	int status = 0;
+	{
+		StartupProfiler::Scope timer(StartupProfiler::LINK);
+		glGetProgramiv(handle, GL_LINK_STATUS, &status);
+	}
 	std::string errString;
-	glGetProgramiv(handle, GL_LINK_STATUS, &status);
 	if (GL_FALSE == status) {
-		// Store log and return false
-		int length = 0;
-		glGetProgramiv(handle, GL_INFO_LOG_LENGTH, &length);
-		errString += "Program link failed:\n";
-		if (length > 0) {
-			std::string log(length,' ');
-			int written = 0;
-			glGetProgramInfoLog(handle, length, &written, &log[0]);
-			errString += log;
+		// A failed compile is reported in preference to the link error it caused
+		errString = compileLog();
+		if (errString.empty()) {
+			int length = 0;
+			glGetProgramiv(handle, GL_INFO_LOG_LENGTH, &length);
+			errString += "Program link failed:\n";
+			if (length > 0) {
+				std::string log(length,' ');
+				int written = 0;
+				glGetProgramInfoLog(handle, length, &written, &log[0]);
+				errString += log;
+			}
 		}
 	}
 	else {
 		findUniformLocations();
 		linked = true;
+		saveBinary();
 	}
 	 
 	detachAndDeleteShaderObjects();
+	sources.clear();
+	linkIssued = false;
 
 	if( GL_FALSE == status ) throw GLSLProgramException(errString);
 }
 
+string GLSLProgram::compileLog() {
+    for (const ShaderSource &s : sources) {
+        int result = GL_TRUE;
+        glGetShaderiv(s.shader, GL_COMPILE_STATUS, &result);
+        if (GL_TRUE == result) continue;
+
+		std::string msg;
+		if (!s.fileName.empty()) {
+			msg = s.fileName + ": shader compliation failed\n";
+		}
+		else {
+			msg = "Shader compilation failed.\n";
+		}
+
+        int length = 0;
+        glGetShaderiv(s.shader, GL_INFO_LOG_LENGTH, &length);
+        if (length > 0) {
+            std::string log(length, ' ');
+            int written = 0;
+            glGetShaderInfoLog(s.shader, length, &written, &log[0]);
+			msg += log;
+        }
+
+        // Messages name files by source-string number once includes are involved
+        if (s.files.size() > 1) {
+            msg += "Source strings:\n";
+            for (size_t i = 0; i < s.files.size(); i++) {
+                msg += "  " + std::to_string(i) + " = " + s.files[i] + "\n";
+            }
+        }
+        return msg;
+    }
+    return "";
+}
+
+bool GLSLProgram::loadBinary() {
+    if (!binariesSupported()) return false;
+
+    std::vector<unsigned char> data;
+    {
+        StartupProfiler::Scope timer(StartupProfiler::READ);
+        if (!MappedFile::readFile(binaryPath(binaryKey), data)) return false;
+    }
+
+    ProgramBinaryHeader header;
+    if (data.size() < sizeof(header)) return false;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, PROGRAM_BINARY_MAGIC, 4) != 0 || header.version != PROGRAM_BINARY_VERSION ||
+        header.key != binaryKey || header.length != data.size() - sizeof(header)) {
+        return false;
+    }
+
+    // Drivers may reject a binary after an update; that is not an error
+    StartupProfiler::Scope timer(StartupProfiler::LINK);
+    glProgramBinary(handle, header.format, data.data() + sizeof(header), (GLsizei)header.length);
+    int status = 0;
+    glGetProgramiv(handle, GL_LINK_STATUS, &status);
+    return status == GL_TRUE;
+}
+
+void GLSLProgram::saveBinary() {
+    if (!binariesSupported()) return;
+
+    GLint length = 0;
+    glGetProgramiv(handle, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<unsigned char> data(sizeof(ProgramBinaryHeader) + length);
+    ProgramBinaryHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, PROGRAM_BINARY_MAGIC, 4);
+    header.version = PROGRAM_BINARY_VERSION;
+    header.key = binaryKey;
+
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(handle, length, &written, &format, data.data() + sizeof(header));
+    if (written <= 0) return;
+    header.format = format;
+    header.length = (uint32_t)written;
+    std::memcpy(data.data(), &header, sizeof(header));
+    data.resize(sizeof(header) + written);
+
+    if (!MappedFile::writeFileAtomic(binaryPath(binaryKey), data.data(), data.size())) {
+        std::cerr << "[WARNING] Unable to write program binary for " << programName << std::endl;
+    }
+}
+
 void GLSLProgram::findUniformLocations() {
     uniformLocations.clear();
 
@@ -241,7 +433,7 @@ void GLSLProgram::findUniformLocations() {
 void GLSLProgram::use() {
     if (handle <= 0 || (!linked))
         throw GLSLProgramException("Shader has not been linked");
-    glUseProgram(handle);
+    GLStateCache::useProgram(handle);
 }
 
 int GLSLProgram::getHandle() {
@@ -6,8 +6,10 @@
 
 #include <glad/glad.h>
 
+#include <cstdint>
 #include <string>
 #include <map>
+#include <vector>
 #include <glm/glm.hpp>
 #include <stdexcept>
 
@@ -28,12 +30,59 @@ namespace GLSLShader {
     };
 };
 
+// A uniform location resolved once, typed by the value it takes.  set()
+// writes straight into the program with glProgramUniform*, so the program
+// does not have to be bound and no name lookup happens per call.  A handle
+// to a uniform the compiler removed is valid to set and does nothing.
+template <typename T>
+class UniformHandle {
+private:
+    GLuint program;
+    GLint location;
+
+public:
+    UniformHandle() : program(0), location(-1) {}
+    UniformHandle(GLuint program, GLint location) : program(program), location(location) {}
+
+    bool isActive() const { return location >= 0; }
+    inline void set(const T &value) const;
+};
+
+template <> inline void UniformHandle<float>::set(const float &v) const { glProgramUniform1f(program, location, v); }
+template <> inline void UniformHandle<int>::set(const int &v) const { glProgramUniform1i(program, location, v); }
+template <> inline void UniformHandle<GLuint>::set(const GLuint &v) const { glProgramUniform1ui(program, location, v); }
+template <> inline void UniformHandle<bool>::set(const bool &v) const { glProgramUniform1i(program, location, v); }
+template <> inline void UniformHandle<glm::ivec2>::set(const glm::ivec2 &v) const { glProgramUniform2i(program, location, v.x, v.y); }
+template <> inline void UniformHandle<glm::vec2>::set(const glm::vec2 &v) const { glProgramUniform2f(program, location, v.x, v.y); }
+template <> inline void UniformHandle<glm::vec3>::set(const glm::vec3 &v) const { glProgramUniform3f(program, location, v.x, v.y, v.z); }
+template <> inline void UniformHandle<glm::vec4>::set(const glm::vec4 &v) const { glProgramUniform4f(program, location, v.x, v.y, v.z, v.w); }
+template <> inline void UniformHandle<glm::mat3>::set(const glm::mat3 &m) const { glProgramUniformMatrix3fv(program, location, 1, GL_FALSE, &m[0][0]); }
+template <> inline void UniformHandle<glm::mat4>::set(const glm::mat4 &m) const { glProgramUniformMatrix4fv(program, location, 1, GL_FALSE, &m[0][0]); }
+
 class GLSLProgram {
 private:
     GLuint handle;
     bool linked;
+    std::string programName;        // Source files, joined with '+', for diagnostics
     std::map<std::string, int> uniformLocations;
 
+    // Sources queued by compileShader(); compiled when the program is linked
+    struct ShaderSource {
+        GLSLShader::GLSLShaderType type;
+        std::string source;                 // After preprocessing
+        std::string fileName;
+        std::vector<std::string> files;     // fileName and its includes, by source-string number
+        GLuint shader;
+    };
+    std::vector<ShaderSource> sources;
+    std::vector<std::pair<std::string, std::string>> defines;
+    bool linkIssued;
+    uint64_t binaryKey;
+
+    bool loadBinary();
+    void saveBinary();
+    std::string compileLog();
+
     inline GLint getUniformLocation(const char *name);
 	void detachAndDeleteShaderObjects();
     bool fileExists(const std::string &fileName);
@@ -52,6 +101,15 @@ public:
     void compileShader(const std::string &source, GLSLShader::GLSLShaderType type,
                        const char *fileName = NULL);
 
+    // Adds "#define name value" after the #version line of every stage
+    // compiled from here on, to specialise shared source
+    void define(const std::string &name, const std::string &value = "1");
+    void define(const std::string &name, float value);
+
+    // Starts compiling and linking without waiting for the driver.  Issue
+    // this for every program before calling link() on any of them so the
+    // compiles can run in parallel.
+    void linkAsync();
     void link();
     void validate();
     void use();
@@ -73,6 +131,13 @@ public:
     void setUniform(const char *name, bool val);
     void setUniform(const char *name, GLuint val);
 
+    // Resolves a uniform once for repeated set() calls; the program must be linked
+    template <typename T>
+    UniformHandle<T> uniform(const char *name) {
+        if (!linked) throw GLSLProgramException(std::string("Uniform ") + name + " requested before link");
+        return UniformHandle<T>(handle, getUniformLocation(name));
+    }
+
     void findUniformLocations();
     void printActiveUniforms();
     void printActiveUniformBlocks();
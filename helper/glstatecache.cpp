@@ -0,0 +1,34 @@
+#include "glstatecache.h"
+
+GLuint GLStateCache::program = GLStateCache::UNKNOWN;
+GLuint GLStateCache::vertexArray = GLStateCache::UNKNOWN;
+GLuint GLStateCache::textures[GLStateCache::MAX_UNITS] = {
+    UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN,
+    UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN
+};
+
+void GLStateCache::useProgram(GLuint p) {
+    if (p == program) return;
+    glUseProgram(p);
+    program = p;
+}
+
+void GLStateCache::bindTexture(GLuint unit, GLuint texture) {
+    if (unit < MAX_UNITS) {
+        if (textures[unit] == texture) return;
+        textures[unit] = texture;
+    }
+    glBindTextureUnit(unit, texture);
+}
+
+void GLStateCache::bindVertexArray(GLuint vao) {
+    if (vao == vertexArray) return;
+    glBindVertexArray(vao);
+    vertexArray = vao;
+}
+
+void GLStateCache::invalidate() {
+    program = UNKNOWN;
+    vertexArray = UNKNOWN;
+    for (GLuint& t : textures) t = UNKNOWN;
+}
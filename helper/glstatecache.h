@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Remembers the current program, texture unit bindings and vertex array so
+// repeated binds of the same object cost nothing.  Textures are bound with
+// glBindTextureUnit, so there is no active-texture selector to track.
+//
+// Every bind of these objects during rendering must go through here.  Code
+// that changes them directly, or deletes a bound object, must call
+// invalidate() afterwards.
+class GLStateCache {
+public:
+    static void useProgram(GLuint program);
+    static void bindTexture(GLuint unit, GLuint texture);
+    static void bindVertexArray(GLuint vao);
+
+    // Forget all cached bindings; the next bind of each always reaches GL
+    static void invalidate();
+
+private:
+    static const GLuint UNKNOWN = ~0u;
+    static const GLuint MAX_UNITS = 16;
+
+    static GLuint program;
+    static GLuint vertexArray;
+    static GLuint textures[MAX_UNITS];
+};
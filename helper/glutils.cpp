@@ -1,7 +1,10 @@
 #include "glutils.h"
 #include <glad/glad.h>
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
 
 #include <cstdio>
+#include <cstring>
 #include <string>
 using std::string;
 #include <iostream>
@@ -160,4 +163,18 @@ void dumpGLInfo(bool dumpExtensions) {
     }
 }
 
+bool hasExtension(const char * name) {
+    GLint nExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &nExtensions);
+    for( int i = 0; i < nExtensions; i++ ) {
+        const char * ext = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if( ext != nullptr && std::strcmp(ext, name) == 0 ) return true;
+    }
+    return false;
+}
+
+void * getProcAddress(const char * name) {
+    return reinterpret_cast<void *>(glfwGetProcAddress(name));
+}
+
 } // namespace GLUtils
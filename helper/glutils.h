@@ -7,6 +7,12 @@ namespace GLUtils
     int checkForOpenGLError(const char *, int);
     
     void dumpGLInfo(bool dumpExtensions = false);
+
+    // True if the current context advertises the named extension
+    bool hasExtension(const char * name);
+
+    // Entry point for an extension glad was not generated with
+    void * getProcAddress(const char * name);
     
     void APIENTRY debugCallback( GLenum source, GLenum type, GLuint id,
 		GLenum severity, GLsizei length, const GLchar * msg, const void * param );
@@ -0,0 +1,244 @@
+#include "gpuprofiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+    const double REPORT_SECONDS = 2.0;
+
+    const GLenum STATISTIC_TARGETS[GpuProfiler::STATISTIC_COUNT] = {
+        GL_VERTEX_SHADER_INVOCATIONS,
+        GL_PRIMITIVES_SUBMITTED,
+        GL_CLIPPING_OUTPUT_PRIMITIVES,
+        GL_FRAGMENT_SHADER_INVOCATIONS,
+        GL_COMPUTE_SHADER_INVOCATIONS
+    };
+
+    const char* STATISTIC_NAMES[GpuProfiler::STATISTIC_COUNT] = {
+        "vertex_invocations",
+        "primitives_submitted",
+        "clipped_primitives",
+        "fragment_invocations",
+        "compute_invocations"
+    };
+}
+
+GpuProfiler::GpuProfiler() : current(0), enabled(false), inFrame(false), inScope(false), hasStatistics(false),
+    reportIndex(0) {}
+
+GpuProfiler::~GpuProfiler() {
+    release();
+}
+
+void GpuProfiler::setEnabled(bool enable, const std::string& csvFile) {
+    if (enable == enabled) return;
+
+    if (enable) {
+        hasStatistics = GLAD_GL_VERSION_4_6 != 0;
+        passes.clear();
+        reportIndex = 0;
+        lastReport = std::chrono::steady_clock::now();
+
+        csv.open(csvFile, std::ios::out | std::ios::trunc);
+        if (csv) {
+            csv << "report,pass,frames,avg_ms,p99_ms";
+            for (const char* name : STATISTIC_NAMES) csv << ",avg_" << name;
+            csv << '\n';
+        }
+        else {
+            std::cerr << "[WARNING] Unable to write " << csvFile << "; GPU profile goes to the console only" << std::endl;
+        }
+        std::cout << "[INFO] GPU profiling on" << (hasStatistics ? "" : " (no pipeline statistics)") << std::endl;
+        enabled = true;
+        return;
+    }
+
+    // Frames still in flight are discarded
+    report();
+    release();
+    csv.close();
+    enabled = false;
+    inFrame = false;
+    inScope = false;
+    std::cout << "[INFO] GPU profiling off" << std::endl;
+}
+
+void GpuProfiler::beginFrame() {
+    if (!enabled) return;
+
+    // Read every finished frame, oldest first, without waiting
+    for (int i = 1; i <= SLOTS; ++i) {
+        Frame& frame = frames[(current + i) % SLOTS];
+        if (!frame.pending) continue;
+        GLint available = 0;
+        glGetQueryObjectiv(frame.records.back().timestamps[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+        collect(frame);
+        frame.pending = false;
+    }
+
+    if (std::chrono::steady_clock::now() - lastReport >= std::chrono::duration<double>(REPORT_SECONDS)) {
+        report();
+        lastReport = std::chrono::steady_clock::now();
+    }
+
+    // Skip profiling this frame if its slot is still in flight
+    current = (current + 1) % SLOTS;
+    Frame& frame = frames[current];
+    inFrame = !frame.pending;
+    if (!inFrame) return;
+    frame.records.clear();
+    frame.timestampsUsed = 0;
+    frame.statisticsUsed = 0;
+}
+
+void GpuProfiler::endFrame() {
+    if (!inFrame) return;
+    frames[current].pending = !frames[current].records.empty();
+    inFrame = false;
+}
+
+void GpuProfiler::begin(const char* name) {
+    if (!inFrame || inScope) return;
+    inScope = true;
+
+    Frame& frame = frames[current];
+    Record record = {};
+    record.pass = passIndex(name);
+    record.timestamps[0] = allocate(frame.timestampQueries, frame.timestampsUsed);
+    glQueryCounter(record.timestamps[0], GL_TIMESTAMP);
+    if (hasStatistics) {
+        for (int s = 0; s < STATISTIC_COUNT; ++s) {
+            size_t used = frame.statisticsUsed;
+            record.statistics[s] = allocate(frame.statisticQueries[s], used);
+            glBeginQuery(STATISTIC_TARGETS[s], record.statistics[s]);
+        }
+        ++frame.statisticsUsed;
+    }
+    frame.records.push_back(record);
+}
+
+void GpuProfiler::end() {
+    if (!inScope) return;
+    inScope = false;
+
+    Frame& frame = frames[current];
+    Record& record = frame.records.back();
+    if (hasStatistics) {
+        for (int s = STATISTIC_COUNT - 1; s >= 0; --s) glEndQuery(STATISTIC_TARGETS[s]);
+    }
+    record.timestamps[1] = allocate(frame.timestampQueries, frame.timestampsUsed);
+    glQueryCounter(record.timestamps[1], GL_TIMESTAMP);
+}
+
+GLuint GpuProfiler::allocate(std::vector<GLuint>& pool, size_t& used) {
+    if (used == pool.size()) {
+        GLuint query = 0;
+        glGenQueries(1, &query);
+        pool.push_back(query);
+    }
+    return pool[used++];
+}
+
+int GpuProfiler::passIndex(const char* name) {
+    for (size_t i = 0; i < passes.size(); ++i) {
+        if (passes[i].name == name) return (int)i;
+    }
+    Pass pass;
+    pass.name = name;
+    pass.milliseconds.resize(SAMPLES);
+    for (auto& samples : pass.statistics) samples.resize(SAMPLES);
+    passes.push_back(std::move(pass));
+    return (int)passes.size() - 1;
+}
+
+// Sums the frame's scopes per pass, then adds one sample to each pass seen
+void GpuProfiler::collect(Frame& frame) {
+    std::vector<int> seen;
+    for (const Record& record : frame.records) {
+        Pass& pass = passes[record.pass];
+        if (std::find(seen.begin(), seen.end(), record.pass) == seen.end()) {
+            seen.push_back(record.pass);
+            pass.frameMilliseconds = 0.0f;
+            std::fill(std::begin(pass.frameStatistics), std::end(pass.frameStatistics), 0);
+        }
+
+        GLuint64 start = 0, finish = 0;
+        glGetQueryObjectui64v(record.timestamps[0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(record.timestamps[1], GL_QUERY_RESULT, &finish);
+        pass.frameMilliseconds += (finish - start) / 1.0e6f;
+        if (hasStatistics) {
+            for (int s = 0; s < STATISTIC_COUNT; ++s) {
+                GLuint64 value = 0;
+                glGetQueryObjectui64v(record.statistics[s], GL_QUERY_RESULT, &value);
+                pass.frameStatistics[s] += value;
+            }
+        }
+    }
+
+    for (int index : seen) {
+        Pass& pass = passes[index];
+        pass.milliseconds[pass.next] = pass.frameMilliseconds;
+        for (int s = 0; s < STATISTIC_COUNT; ++s) pass.statistics[s][pass.next] = pass.frameStatistics[s];
+        pass.next = (pass.next + 1) % SAMPLES;
+        pass.count = std::min(pass.count + 1, (size_t)SAMPLES);
+    }
+}
+
+void GpuProfiler::report() {
+    if (passes.empty()) return;
+    ++reportIndex;
+
+    std::cout << "[INFO] GPU profile, last " << SAMPLES << " frames:" << std::endl;
+    for (const Pass& pass : passes) {
+        if (pass.count == 0) continue;
+
+        std::vector<float> sorted(pass.milliseconds.begin(), pass.milliseconds.begin() + pass.count);
+        std::sort(sorted.begin(), sorted.end());
+        double total = 0.0;
+        for (float ms : sorted) total += ms;
+        float average = (float)(total / pass.count);
+        size_t rank = (size_t)std::ceil(0.99 * pass.count);
+        float p99 = sorted[std::min(pass.count, std::max(rank, (size_t)1)) - 1];
+
+        double statistics[STATISTIC_COUNT] = {};
+        for (int s = 0; s < STATISTIC_COUNT; ++s) {
+            for (size_t i = 0; i < pass.count; ++i) statistics[s] += (double)pass.statistics[s][i];
+            statistics[s] /= pass.count;
+        }
+
+        std::cout << "[INFO]   " << std::left << std::setw(18) << pass.name << std::right << std::fixed
+                  << std::setprecision(3) << " avg " << std::setw(7) << average << " ms  p99 " << std::setw(7)
+                  << p99 << " ms";
+        if (hasStatistics) {
+            std::cout << std::setprecision(0) << "  vs " << statistics[VERTEX_INVOCATIONS] << "  prims "
+                      << statistics[PRIMITIVES_SUBMITTED] << "  fs " << statistics[FRAGMENT_INVOCATIONS] << "  cs "
+                      << statistics[COMPUTE_INVOCATIONS];
+        }
+        std::cout << std::defaultfloat << std::endl;
+
+        if (csv) {
+            csv << reportIndex << ',' << pass.name << ',' << pass.count << ',' << average << ',' << p99;
+            for (int s = 0; s < STATISTIC_COUNT; ++s) {
+                csv << ',';
+                if (hasStatistics) csv << (GLuint64)std::llround(statistics[s]);
+            }
+            csv << '\n';
+        }
+    }
+    if (csv) csv.flush();
+}
+
+void GpuProfiler::release() {
+    for (Frame& frame : frames) {
+        if (!frame.timestampQueries.empty()) {
+            glDeleteQueries((GLsizei)frame.timestampQueries.size(), frame.timestampQueries.data());
+        }
+        for (auto& pool : frame.statisticQueries) {
+            if (!pool.empty()) glDeleteQueries((GLsizei)pool.size(), pool.data());
+        }
+        frame = Frame();
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// GPU time and pipeline statistics per named pass.  Scopes are bracketed
+// with GL_TIMESTAMP counters rather than GL_TIME_ELAPSED, which cannot
+// nest inside the frame-wide query DynamicResolution keeps open.  Where
+// the context has pipeline statistics queries (core in GL 4.6), each scope
+// also counts vertices, primitives and shader invocations.
+//
+// Each frame's queries belong to one slot of a ring and are read a few
+// frames later, once the GPU has finished, so nothing waits.  The last
+// SAMPLES frames of each pass give its rolling average and 99th
+// percentile, printed every few seconds and appended to a CSV file.
+//
+// Scopes must not nest: statistics queries of one kind cannot overlap.
+class GpuProfiler {
+public:
+    static const int SLOTS = 4;         // Frames of queries in flight
+    static const int SAMPLES = 240;     // Frames in the rolling window
+
+    // Counters from the pipeline statistics queries
+    enum Statistic {
+        VERTEX_INVOCATIONS,
+        PRIMITIVES_SUBMITTED,
+        CLIPPED_PRIMITIVES,             // Primitives out of the clipper
+        FRAGMENT_INVOCATIONS,
+        COMPUTE_INVOCATIONS,
+        STATISTIC_COUNT
+    };
+
+    class Scope {
+    public:
+        Scope(GpuProfiler& profiler, const char* name) : profiler(profiler) { profiler.begin(name); }
+        ~Scope() { profiler.end(); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        GpuProfiler& profiler;
+    };
+
+    GpuProfiler();
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    // Starts or stops profiling; starting opens csvFile, stopping prints
+    // the final summary and closes it
+    void setEnabled(bool enabled, const std::string& csvFile = "gpu_profile.csv");
+    bool isEnabled() const { return enabled; }
+
+    // Brackets one frame; beginFrame also collects finished frames
+    void beginFrame();
+    void endFrame();
+
+    void begin(const char* name);
+    void end();
+
+private:
+    struct Record {
+        int pass;
+        GLuint timestamps[2];
+        GLuint statistics[STATISTIC_COUNT];
+    };
+
+    // A query keeps the target it was first used with, so each target
+    // has its own pool
+    struct Frame {
+        std::vector<Record> records;
+        std::vector<GLuint> timestampQueries;
+        std::vector<GLuint> statisticQueries[STATISTIC_COUNT];
+        size_t timestampsUsed = 0;
+        size_t statisticsUsed = 0;
+        bool pending = false;
+    };
+
+    struct Pass {
+        std::string name;
+        std::vector<float> milliseconds;        // Ring of the last SAMPLES frames
+        std::vector<GLuint64> statistics[STATISTIC_COUNT];
+        size_t next = 0;
+        size_t count = 0;
+        float frameMilliseconds = 0.0f;         // Sums for the frame being read
+        GLuint64 frameStatistics[STATISTIC_COUNT] = {};
+    };
+
+    Frame frames[SLOTS];
+    std::vector<Pass> passes;
+    int current;
+    bool enabled;
+    bool inFrame;
+    bool inScope;
+    bool hasStatistics;
+    std::chrono::steady_clock::time_point lastReport;
+    unsigned reportIndex;
+    std::ofstream csv;
+
+    static GLuint allocate(std::vector<GLuint>& pool, size_t& used);
+    int passIndex(const char* name);
+    void collect(Frame& frame);
+    void report();
+    void release();
+};
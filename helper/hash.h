@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// 64-bit content hashing used to key the on-disk caches.  bytes() is
+// xxHash64 (four parallel lanes of 32 bytes per step, then an avalanche
+// finaliser), so hashing a multi-megabyte asset stays well below the cost
+// of reading it and nearby inputs do not cluster.
+namespace Hash {
+
+    const uint64_t SEED = 0;
+
+    const uint64_t PRIME1 = 0x9e3779b185ebca87ULL;
+    const uint64_t PRIME2 = 0xc2b2ae3d27d4eb4fULL;
+    const uint64_t PRIME3 = 0x165667b19e3779f9ULL;
+    const uint64_t PRIME4 = 0x85ebca77c2b2ae63ULL;
+    const uint64_t PRIME5 = 0x27d4eb2f165667c5ULL;
+
+    inline uint64_t rotl(uint64_t x, int r) {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    inline uint64_t read64(const unsigned char* p) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        return v;
+    }
+
+    inline uint64_t read32(const unsigned char* p) {
+        uint32_t v;
+        std::memcpy(&v, p, 4);
+        return v;
+    }
+
+    inline uint64_t round(uint64_t acc, uint64_t input) {
+        acc += input * PRIME2;
+        acc = rotl(acc, 31);
+        return acc * PRIME1;
+    }
+
+    inline uint64_t mergeRound(uint64_t acc, uint64_t lane) {
+        acc ^= round(0, lane);
+        return acc * PRIME1 + PRIME4;
+    }
+
+    inline uint64_t avalanche(uint64_t h) {
+        h ^= h >> 33;
+        h *= PRIME2;
+        h ^= h >> 29;
+        h *= PRIME3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    // Folds a single value into a running key
+    inline uint64_t combine(uint64_t h, uint64_t value) {
+        return avalanche(rotl(h ^ round(0, value), 27) * PRIME1 + PRIME4);
+    }
+
+    inline uint64_t bytes(const void* data, size_t size, uint64_t seed = SEED) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        const unsigned char* end = p + size;
+        uint64_t h;
+
+        if (size >= 32) {
+            uint64_t v1 = seed + PRIME1 + PRIME2;
+            uint64_t v2 = seed + PRIME2;
+            uint64_t v3 = seed;
+            uint64_t v4 = seed - PRIME1;
+            do {
+                v1 = round(v1, read64(p));
+                v2 = round(v2, read64(p + 8));
+                v3 = round(v3, read64(p + 16));
+                v4 = round(v4, read64(p + 24));
+                p += 32;
+            } while (p + 32 <= end);
+
+            h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            h = mergeRound(h, v1);
+            h = mergeRound(h, v2);
+            h = mergeRound(h, v3);
+            h = mergeRound(h, v4);
+        }
+        else {
+            h = seed + PRIME5;
+        }
+
+        h += (uint64_t)size;
+
+        for (; p + 8 <= end; p += 8) {
+            h ^= round(0, read64(p));
+            h = rotl(h, 27) * PRIME1 + PRIME4;
+        }
+        if (p + 4 <= end) {
+            h ^= read32(p) * PRIME1;
+            h = rotl(h, 23) * PRIME2 + PRIME3;
+            p += 4;
+        }
+        for (; p < end; ++p) {
+            h ^= (*p) * PRIME5;
+            h = rotl(h, 11) * PRIME1;
+        }
+        return avalanche(h);
+    }
+
+    inline uint64_t string(const std::string& str, uint64_t h = SEED) {
+        return bytes(str.data(), str.size(), h);
+    }
+
+    inline std::string toHex(uint64_t h) {
+        static const char digits[] = "0123456789abcdef";
+        std::string out(16, '0');
+        for (int i = 15; i >= 0; --i) {
+            out[i] = digits[h & 0xf];
+            h >>= 4;
+        }
+        return out;
+    }
+}
@@ -0,0 +1,195 @@
+#include "mappedfile.h"
+#include "startupprofiler.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <thread>
+#include <functional>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef _WIN32
+MappedFile::MappedFile() : ptr(nullptr), length(0), fileHandle(nullptr), mappingHandle(nullptr) {}
+#else
+MappedFile::MappedFile() : ptr(nullptr), length(0), fd(-1) {}
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept : MappedFile() {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this == &other) return *this;
+    close();
+    ptr = other.ptr;
+    length = other.length;
+    other.ptr = nullptr;
+    other.length = 0;
+#ifdef _WIN32
+    fileHandle = other.fileHandle;
+    mappingHandle = other.mappingHandle;
+    other.fileHandle = nullptr;
+    other.mappingHandle = nullptr;
+#else
+    fd = other.fd;
+    other.fd = -1;
+#endif
+    return *this;
+}
+
+bool MappedFile::open(const std::string& fileName) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == NULL) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    ptr = static_cast<const unsigned char*>(view);
+    length = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int handle = ::open(fileName.c_str(), O_RDONLY);
+    if (handle < 0) return false;
+
+    struct stat info;
+    if (fstat(handle, &info) != 0 || info.st_size == 0) {
+        ::close(handle);
+        return false;
+    }
+
+    void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, handle, 0);
+    if (view == MAP_FAILED) {
+        ::close(handle);
+        return false;
+    }
+    // Texel and mesh payloads are consumed front to back
+    madvise(view, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+    fd = handle;
+    ptr = static_cast<const unsigned char*>(view);
+    length = (size_t)info.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (ptr) UnmapViewOfFile(ptr);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (ptr) munmap(const_cast<unsigned char*>(ptr), length);
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+#endif
+    ptr = nullptr;
+    length = 0;
+}
+
+bool MappedFile::readFile(const std::string& fileName, std::vector<unsigned char>& out) {
+    std::ifstream in;
+    std::streamsize size;
+    {
+        StartupProfiler::Scope timer(StartupProfiler::OPEN);
+        in.open(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!in) return false;
+
+        size = in.tellg();
+        if (size < 0) return false;
+        in.seekg(0, std::ios::beg);
+    }
+
+    StartupProfiler::Scope timer(StartupProfiler::READ);
+    out.resize((size_t)size);
+    if (size > 0 && !in.read(reinterpret_cast<char*>(out.data()), size)) {
+        out.clear();
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::fileExists(const std::string& fileName) {
+    std::error_code ec;
+    return fs::is_regular_file(fileName, ec);
+}
+
+bool MappedFile::fileStamp(const std::string& fileName, uint64_t& size, uint64_t& modified) {
+    std::error_code ec;
+    uintmax_t bytes = fs::file_size(fileName, ec);
+    if (ec) return false;
+    fs::file_time_type time = fs::last_write_time(fileName, ec);
+    if (ec) return false;
+
+    size = (uint64_t)bytes;
+    modified = (uint64_t)time.time_since_epoch().count();
+    return true;
+}
+
+bool MappedFile::writeFileAtomic(const std::string& fileName, const void* data, size_t size) {
+    std::error_code ec;
+    fs::path target(fileName);
+    if (target.has_parent_path()) {
+        fs::create_directories(target.parent_path(), ec);
+    }
+
+    // Unique per thread so parallel writers never share a temporary
+    std::string tmpName = fileName + ".tmp" +
+        std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream out(tmpName, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(static_cast<const char*>(data), (std::streamsize)size);
+        if (!out) {
+            out.close();
+            fs::remove(tmpName, ec);
+            return false;
+        }
+    }
+
+    fs::rename(tmpName, target, ec);
+    if (ec) {
+        fs::remove(tmpName, ec);
+        return false;
+    }
+    return true;
+}
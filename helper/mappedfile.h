@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Read-only memory mapping of a whole file.  Movable, not copyable.
+class MappedFile {
+private:
+    const unsigned char* ptr;
+    size_t length;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fd;
+#endif
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::string& fileName);
+    void close();
+
+    bool isOpen() const { return ptr != nullptr; }
+    const unsigned char* data() const { return ptr; }
+    size_t size() const { return length; }
+
+    // Whole-file helpers for the loaders that still want a private copy
+    static bool readFile(const std::string& fileName, std::vector<unsigned char>& out);
+    static bool fileExists(const std::string& fileName);
+
+    // Size and last write time of fileName, without opening it
+    static bool fileStamp(const std::string& fileName, uint64_t& size, uint64_t& modified);
+
+    // Writes to a temporary file and renames it into place, so a reader
+    // never maps a half-written cache entry.
+    static bool writeFileAtomic(const std::string& fileName, const void* data, size_t size);
+};
@@ -0,0 +1,56 @@
+#include "renderqueue.h"
+
+#include <cstring>
+
+uint64_t RenderQueue::makeKey(Pass pass, uint32_t program, uint32_t material, float depth) {
+    // Non-negative floats order the same as their bit patterns
+    if (!(depth > 0.0f)) depth = 0.0f;
+    uint32_t depthBits;
+    std::memcpy(&depthBits, &depth, sizeof(depthBits));
+
+    return ((uint64_t)(pass & 0xF) << 60) |
+           ((uint64_t)(program & 0xFFF) << 48) |
+           ((uint64_t)(material & 0xFFFF) << 32) |
+           depthBits;
+}
+
+void RenderQueue::submit(uint64_t key, Draw draw) {
+    items.push_back({ key, (uint32_t)draws.size() });
+    draws.push_back(std::move(draw));
+}
+
+void RenderQueue::execute(const PassBegin& beginPass) {
+    sort();
+    int pass = -1;
+    for (const Item& item : items) {
+        int itemPass = (int)(item.key >> 60);
+        if (beginPass && itemPass != pass) beginPass((Pass)itemPass);
+        pass = itemPass;
+        draws[item.draw]();
+    }
+    items.clear();
+    draws.clear();
+}
+
+void RenderQueue::sort() {
+    size_t n = items.size();
+    if (n < 2) return;
+    scratch.resize(n);
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {};
+        for (const Item& item : items) counts[(item.key >> shift) & 0xFF]++;
+
+        // Every key has the same byte here; this pass would not move anything
+        if (counts[(items[0].key >> shift) & 0xFF] == n) continue;
+
+        size_t offset = 0;
+        for (size_t& c : counts) {
+            size_t count = c;
+            c = offset;
+            offset += count;
+        }
+        for (const Item& item : items) scratch[counts[(item.key >> shift) & 0xFF]++] = item;
+        items.swap(scratch);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Draws collected during a frame and issued in sorted order.  Each draw has
+// a 64-bit key, most significant field first:
+//
+//   pass (4 bits) | program (12) | material (16) | depth (32)
+//
+// so draws run pass by pass, grouped by program and then by material to
+// minimise state changes, and front to back within a group.  Keys are
+// sorted with an LSD radix sort, skipping bytes every key shares.
+class RenderQueue {
+public:
+    enum Pass {
+        PASS_DEPTH = 0,       // Depth-only pre-pass, before anything is shaded
+        PASS_OPAQUE = 1,
+        PASS_SKY = 2          // After the opaque draws, only fills empty pixels
+    };
+
+    using Draw = std::function<void()>;
+    using PassBegin = std::function<void(Pass)>;
+
+    // depth is the distance from the camera; smaller draws first
+    static uint64_t makeKey(Pass pass, uint32_t program, uint32_t material, float depth);
+
+    void submit(uint64_t key, Draw draw);
+
+    // Sorts, runs every draw and empties the queue.  beginPass, if given,
+    // is called before the first draw of each pass to set its state.
+    void execute(const PassBegin& beginPass = nullptr);
+
+    size_t size() const { return items.size(); }
+
+private:
+    struct Item {
+        uint64_t key;
+        uint32_t draw;         // Index into draws
+    };
+
+    std::vector<Item> items;
+    std::vector<Item> scratch;
+    std::vector<Draw> draws;
+
+    void sort();
+};
@@ -0,0 +1,73 @@
+#include "renderthread.h"
+#include "scene.h"
+#include "glutils.h"
+#include "startupprofiler.h"
+
+#include <GLFW/glfw3.h>
+
+RenderThread::RenderThread(GLFWwindow* window, Scene& scene) :
+    window(window), scene(scene), pending(-1), rendering(-1), next(0), stopping(false) {
+    thread = std::thread(&RenderThread::run, this);
+}
+
+RenderThread::~RenderThread() {
+    stop();
+}
+
+int RenderThread::acquire() {
+    std::unique_lock<std::mutex> lock(mutex);
+    // The other slot must have been picked up, or its frame would be lost
+    changed.wait(lock, [this]() { return pending < 0 && next != rendering; });
+    int slot = next;
+    next = (next + 1) % SLOTS;
+    return slot;
+}
+
+void RenderThread::submit(int slot) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = slot;
+    }
+    changed.notify_all();
+}
+
+void RenderThread::stop() {
+    if (!thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    thread.join();
+}
+
+void RenderThread::run() {
+    glfwMakeContextCurrent(window);
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this]() { return stopping || pending >= 0; });
+            if (pending < 0) break;     // stopping and drained
+            rendering = pending;
+            pending = -1;
+        }
+        changed.notify_all();
+
+        GLUtils::checkForOpenGLError(__FILE__, __LINE__);
+        scene.readPacket(rendering);
+        scene.render();
+        glfwSwapBuffers(window);
+
+        // Startup ends once the first frame has been presented
+        if (StartupProfiler::active()) StartupProfiler::finish();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            rendering = -1;
+        }
+        changed.notify_all();
+    }
+
+    glfwMakeContextCurrent(nullptr);
+}
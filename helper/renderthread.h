@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+struct GLFWwindow;
+class Scene;
+
+// Thread that owns the GL context and draws the frames the game thread
+// prepares.  Each frame's render packet goes into one of two slots: while
+// the render thread submits frame N from one slot, the game thread
+// simulates frame N+1 into the other.  The game thread is never more than
+// one frame ahead.
+//
+// The window's context must not be current on any other thread while the
+// render thread runs.
+class RenderThread {
+public:
+    static constexpr int SLOTS = 2;
+
+    RenderThread(GLFWwindow* window, Scene& scene);
+    ~RenderThread();
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // A slot the game thread may write, waiting while one frame is still
+    // queued behind the one being drawn
+    int acquire();
+
+    // Hands a written slot over to be drawn
+    void submit(int slot);
+
+    // Draws what was submitted, then releases the context and joins
+    void stop();
+
+private:
+    GLFWwindow* window;
+    Scene& scene;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable changed;
+    int pending;                // Slot waiting to be drawn, or -1
+    int rendering;              // Slot being drawn, or -1
+    int next;                   // Slot acquire() tries first
+    bool stopping;
+
+    void run();
+};
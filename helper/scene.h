@@ -35,6 +35,17 @@ public:
       */
     virtual void render() = 0;
 
+    /**
+      Called on the game thread after update() to copy what render() needs
+      into one of RenderThread::SLOTS render packets.
+      */
+    virtual void writePacket( int ) { }
+
+    /**
+      Called on the render thread before render() with the packet to draw.
+      */
+    virtual void readPacket( int ) { }
+
     /**
       Called when screen is resized
       */
@@ -2,6 +2,8 @@
 #include "scene.h"
 #include <GLFW/glfw3.h>
 #include "glutils.h"
+#include "startupprofiler.h"
+#include "renderthread.h"
 
 #define WIN_WIDTH 800
 #define WIN_HEIGHT 600
@@ -74,7 +76,8 @@ public:
         scene.initScene();
         scene.resize(fbw, fbh);
 
-        // Enter the main loop
+        // Enter the main loop; the context moves to the render thread and
+        // back
         mainLoop(window, scene);
 
 #ifndef __APPLE__
@@ -86,6 +89,8 @@ public:
 		// Close window and terminate GLFW
 		glfwTerminate();
 
+		StartupProfiler::writeReports("startup_report.txt", "startup_trace.json");
+
         // Exit program
         return EXIT_SUCCESS;
     }
@@ -120,18 +125,26 @@ private:
         }
     }
 
+    // Simulates on this thread while the render thread submits the
+    // previous frame's GL work
     void mainLoop(GLFWwindow * window, Scene & scene) {
+        glfwMakeContextCurrent(nullptr);
+        RenderThread renderThread(window, scene);
+
         while( ! glfwWindowShouldClose(window) && !glfwGetKey(window, GLFW_KEY_ESCAPE) ) {
-            GLUtils::checkForOpenGLError(__FILE__,__LINE__);
-			
             scene.update(float(glfwGetTime()));
-            scene.render();
-            glfwSwapBuffers(window);
+
+            int slot = renderThread.acquire();
+            scene.writePacket(slot);
+            renderThread.submit(slot);
 
             glfwPollEvents();
 			int state = glfwGetKey(window, GLFW_KEY_SPACE);
 			if (state == GLFW_PRESS)
 				scene.animate(!scene.animating());
         }
+
+        renderThread.stop();
+        glfwMakeContextCurrent(window);
     }
 };
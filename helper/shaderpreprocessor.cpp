@@ -0,0 +1,131 @@
+#include "shaderpreprocessor.h"
+#include "glslprogram.h"
+#include "assetarchive.h"
+#include "assetio.h"
+#include "startupprofiler.h"
+
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+namespace fs = std::filesystem;
+using std::string;
+
+namespace {
+    struct Context {
+        std::vector<string> files;
+        std::set<string> included;
+    };
+
+    // Matches "#<directive>" with optional whitespace around the '#'
+    bool isDirective(const string& line, const char* directive, size_t& end) {
+        size_t i = line.find_first_not_of(" \t");
+        if (i == string::npos || line[i] != '#') return false;
+        i = line.find_first_not_of(" \t", i + 1);
+        size_t length = std::char_traits<char>::length(directive);
+        if (i == string::npos || line.compare(i, length, directive) != 0) return false;
+        end = i + length;
+        return end == line.size() || line[end] == ' ' || line[end] == '\t' || line[end] == '"' || line[end] == '<';
+    }
+
+    bool hasVersion(const string& source) {
+        std::istringstream in(source);
+        string line;
+        size_t end;
+        while (std::getline(in, line)) {
+            if (isDirective(line, "version", end)) return true;
+        }
+        return false;
+    }
+
+    string resolve(const string& from, const string& target) {
+        fs::path base = fs::path(from).parent_path();
+        return AssetArchive::normalizeName((base / target).lexically_normal().generic_string());
+    }
+
+    void expand(const string& source, int fileIndex, Context& ctx, std::ostringstream& out,
+        const ShaderPreprocessor::Defines* defines) {
+        std::istringstream in(source);
+        string line;
+        int lineNumber = 0;
+        while (std::getline(in, line)) {
+            ++lineNumber;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+
+            size_t end;
+            if (defines && isDirective(line, "version", end)) {
+                out << line << '\n';
+                for (const auto& d : *defines) out << "#define " << d.first << ' ' << d.second << '\n';
+                out << "#line " << (lineNumber + 1) << ' ' << fileIndex << '\n';
+                defines = nullptr;
+                continue;
+            }
+
+            if (isDirective(line, "include", end)) {
+                size_t open = line.find_first_of("\"<", end);
+                size_t close = open == string::npos ? string::npos : line.find(line[open] == '"' ? '"' : '>', open + 1);
+                if (close == string::npos) {
+                    throw GLSLProgramException(ctx.files[fileIndex] + "(" + std::to_string(lineNumber) +
+                        "): malformed #include");
+                }
+
+                string path = resolve(ctx.files[fileIndex], line.substr(open + 1, close - open - 1));
+                if (ctx.included.insert(path).second) {
+                    string text;
+                    if (!ShaderPreprocessor::readFile(path, text)) {
+                        throw GLSLProgramException(ctx.files[fileIndex] + "(" + std::to_string(lineNumber) +
+                            "): unable to include " + path);
+                    }
+                    int index = (int)ctx.files.size();
+                    ctx.files.push_back(path);
+                    out << "#line 1 " << index << '\n';
+                    expand(text, index, ctx, out, nullptr);
+                }
+                out << "#line " << (lineNumber + 1) << ' ' << fileIndex << '\n';
+                continue;
+            }
+
+            out << line << '\n';
+        }
+    }
+}
+
+string ShaderPreprocessor::process(const string& source, const string& fileName,
+    const Defines& defines, std::vector<string>* files) {
+    Context ctx;
+    ctx.files.push_back(AssetArchive::normalizeName(fileName));
+    ctx.included.insert(ctx.files[0]);
+
+    std::ostringstream out;
+    if (hasVersion(source)) {
+        expand(source, 0, ctx, out, &defines);
+    } else {
+        for (const auto& d : defines) out << "#define " << d.first << ' ' << d.second << '\n';
+        if (!defines.empty()) out << "#line 1 0\n";
+        expand(source, 0, ctx, out, nullptr);
+    }
+
+    if (files) *files = ctx.files;
+    return out.str();
+}
+
+bool ShaderPreprocessor::readFile(const string& fileName, string& contents) {
+    if (const AssetArchive* archive = AssetArchive::mounted()) {
+        if (const AssetArchive::Entry* e = archive->find(fileName, AssetArchive::SHADER)) {
+            contents.assign(reinterpret_cast<const char*>(archive->data(*e)), (size_t)e->size);
+            return true;
+        }
+    }
+
+    // Source read ahead by the startup batch
+    if (AssetIO::prefetched(fileName, contents)) return true;
+
+    StartupProfiler::Scope timer(StartupProfiler::READ);
+    std::ifstream in(fileName, std::ios::in | std::ios::binary);
+    if (!in) return false;
+    std::stringstream code;
+    code << in.rdbuf();
+    contents = code.str();
+    return true;
+}
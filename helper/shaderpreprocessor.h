@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Expands shader source before it reaches the GLSL compiler.
+//
+//  - #include "file" pulls in another file, resolved relative to the
+//    including file.  Each file is included at most once per shader, so
+//    common headers need no guards.
+//  - Defines are inserted directly after the #version line, which lets
+//    one source build several specialised variants.
+//  - #line directives keep compiler messages pointing at the original
+//    line; the source-string number is the file's index in `files`.
+//
+// Errors throw GLSLProgramException.
+class ShaderPreprocessor {
+public:
+    using Defines = std::vector<std::pair<std::string, std::string>>;
+
+    static std::string process(const std::string& source, const std::string& fileName,
+        const Defines& defines, std::vector<std::string>* files = nullptr);
+
+    // Shader text from the mounted archive, the startup prefetch or disk
+    static bool readFile(const std::string& fileName, std::string& contents);
+};
@@ -0,0 +1,48 @@
+#include "shadervariantcache.h"
+
+#include <iostream>
+
+void ShaderVariantCache::addStage(const std::string& fileName) {
+    stages.push_back(fileName);
+}
+
+void ShaderVariantCache::addFeature(uint32_t bit, const std::string& define) {
+    features.emplace_back(bit, define);
+}
+
+void ShaderVariantCache::define(const std::string& name, const std::string& value) {
+    constants.emplace_back(name, value);
+}
+
+void ShaderVariantCache::define(const std::string& name, float value) {
+    floatConstants.emplace_back(name, value);
+}
+
+void ShaderVariantCache::prepare(uint32_t mask) {
+    if (variants.count(mask)) return;
+
+    std::unique_ptr<GLSLProgram> program(new GLSLProgram());
+    for (const auto& c : constants) program->define(c.first, c.second);
+    for (const auto& c : floatConstants) program->define(c.first, c.second);
+    for (const auto& f : features) {
+        if (mask & f.first) program->define(f.second);
+    }
+    for (const auto& stage : stages) program->compileShader(stage.c_str());
+    program->linkAsync();
+
+    variants[mask] = std::move(program);
+}
+
+GLSLProgram& ShaderVariantCache::get(uint32_t mask) {
+    auto it = variants.find(mask);
+    if (it == variants.end()) {
+        prepare(mask);
+        it = variants.find(mask);
+    }
+    if (!it->second->isLinked()) {
+        it->second->link();
+        std::cout << "[INFO] Built shader variant 0x" << std::hex << mask << std::dec
+                  << " of " << stages.front() << " (" << variants.size() << " cached)" << std::endl;
+    }
+    return *it->second;
+}
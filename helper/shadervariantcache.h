@@ -0,0 +1,43 @@
+#pragma once
+
+#include "glslprogram.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Specialised builds of one set of shader stages, keyed by a feature
+// bitmask.  Each feature bit maps to a #define, so a variant only contains
+// the code paths its draw needs and constants fold at compile time.
+// Variants are compiled on first use (or ahead of time with prepare())
+// and go through GLSLProgram's binary cache like any other program.
+//
+// Stages, features and constants must be set before the first variant is
+// built.
+class ShaderVariantCache {
+public:
+    void addStage(const std::string& fileName);
+    void addFeature(uint32_t bit, const std::string& define);
+
+    // Defines shared by every variant
+    void define(const std::string& name, const std::string& value = "1");
+    void define(const std::string& name, float value);
+
+    // Starts building a variant without waiting for the driver
+    void prepare(uint32_t features);
+
+    // Linked program for the given features, built if needed
+    GLSLProgram& get(uint32_t features);
+
+    size_t size() const { return variants.size(); }
+
+private:
+    std::vector<std::string> stages;
+    std::vector<std::pair<uint32_t, std::string>> features;
+    std::vector<std::pair<std::string, std::string>> constants;
+    std::vector<std::pair<std::string, float>> floatConstants;
+    std::map<uint32_t, std::unique_ptr<GLSLProgram>> variants;
+};
@@ -0,0 +1,228 @@
+#include "startupprofiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+using std::string;
+
+namespace {
+    struct Event {
+        StartupProfiler::Phase phase;
+        string asset;
+        uint32_t thread;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    const std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
+
+    std::atomic<bool> recording(true);
+    std::atomic<uint32_t> nextThread(0);
+    std::mutex eventMutex;
+    std::vector<Event> events;
+    uint64_t finishTime = 0;
+
+    thread_local const string* currentAsset = nullptr;
+
+    uint32_t threadIndex() {
+        thread_local uint32_t index = nextThread++;
+        return index;
+    }
+
+    // Static initialisation runs on the thread that goes on to load the
+    // scene, so that is the one labelled "main" even though startup is
+    // finished from the render thread
+    const uint32_t mainThread = threadIndex();
+
+    double toMs(uint64_t ns) {
+        return ns / 1.0e6;
+    }
+
+    double toUs(uint64_t ns) {
+        return ns / 1.0e3;
+    }
+
+    string jsonEscape(const string& s) {
+        string out;
+        for (char c : s) {
+            switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if ((unsigned char)c < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+            }
+        }
+        return out;
+    }
+}
+
+StartupProfiler::AssetScope::AssetScope(const string& asset) : previous(currentAsset) {
+    if (!recording) return;
+    name = asset;
+    currentAsset = &name;
+}
+
+StartupProfiler::AssetScope::~AssetScope() {
+    currentAsset = previous;
+}
+
+StartupProfiler::Scope::Scope(Phase phase) : phase(phase), timing(recording), start(0) {
+    if (timing) start = now();
+}
+
+StartupProfiler::Scope::~Scope() {
+    if (!timing) return;
+    record(phase, currentAsset ? *currentAsset : string(), start, now());
+}
+
+uint64_t StartupProfiler::now() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - processStart).count();
+}
+
+void StartupProfiler::record(Phase phase, const string& asset, uint64_t start, uint64_t end) {
+    if (!recording) return;
+    Event e{ phase, asset.empty() ? string("(unattributed)") : asset, threadIndex(), start, end };
+    std::lock_guard<std::mutex> lock(eventMutex);
+    events.push_back(std::move(e));
+}
+
+void StartupProfiler::finish() {
+    if (!recording) return;
+    size_t count;
+    {
+        std::lock_guard<std::mutex> lock(eventMutex);
+        finishTime = now();
+        recording = false;
+        count = events.size();
+    }
+    std::cout << "[INFO] Startup took " << std::fixed << std::setprecision(1) << toMs(finishTime)
+              << " ms (" << count << " asset phases recorded)" << std::defaultfloat << std::endl;
+}
+
+bool StartupProfiler::active() {
+    return recording;
+}
+
+const char* StartupProfiler::phaseName(Phase phase) {
+    static const char* names[PHASE_COUNT] = {
+        "open", "read", "parse", "normals/tangents", "dedup", "decode", "upload", "compile", "link"
+    };
+    return phase < PHASE_COUNT ? names[phase] : "unknown";
+}
+
+bool StartupProfiler::writeReports(const string& reportFile, const string& traceFile) {
+    std::vector<Event> sorted;
+    uint64_t total;
+    uint32_t main;
+    {
+        std::lock_guard<std::mutex> lock(eventMutex);
+        sorted = events;
+        total = finishTime ? finishTime : now();
+        main = mainThread;
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Event& a, const Event& b) {
+        return a.start != b.start ? a.start < b.start : a.thread < b.thread;
+    });
+
+    // ---- Text report ----
+    uint64_t phaseTotals[PHASE_COUNT] = {};
+    size_t phaseCounts[PHASE_COUNT] = {};
+    std::map<string, std::vector<uint64_t>> assetPhases;
+    size_t nameWidth = 24;
+    uint32_t threads = 0;
+    for (const Event& e : sorted) {
+        phaseTotals[e.phase] += e.end - e.start;
+        phaseCounts[e.phase]++;
+        auto& perPhase = assetPhases[e.asset];
+        perPhase.resize(PHASE_COUNT + 1, 0);
+        perPhase[e.phase] += e.end - e.start;
+        perPhase[PHASE_COUNT] += e.end - e.start;
+        nameWidth = std::max(nameWidth, e.asset.size());
+        threads = std::max(threads, e.thread + 1);
+    }
+
+    std::ofstream report(reportFile, std::ios::out | std::ios::trunc);
+    if (!report) {
+        std::cerr << "[WARNING] Unable to write startup report: " << reportFile << std::endl;
+        return false;
+    }
+    report << std::fixed << std::setprecision(3);
+    report << "Startup profile: " << toMs(total) << " ms from process start to first frame" << "\n";
+    report << sorted.size() << " phases recorded on " << threads << " threads (thread " << main << " is main)\n\n";
+
+    std::vector<int> phaseOrder;
+    for (int p = 0; p < PHASE_COUNT; ++p) phaseOrder.push_back(p);
+    std::sort(phaseOrder.begin(), phaseOrder.end(), [&](int a, int b) { return phaseTotals[a] > phaseTotals[b]; });
+
+    report << "Time by phase (summed over threads, highest first)\n";
+    for (int p : phaseOrder) {
+        if (phaseCounts[p] == 0) continue;
+        report << "  " << std::left << std::setw(18) << phaseName((Phase)p) << std::right
+               << std::setw(12) << toMs(phaseTotals[p]) << " ms  " << std::setw(5) << phaseCounts[p] << " events\n";
+    }
+
+    std::vector<std::pair<string, std::vector<uint64_t>>> assets(assetPhases.begin(), assetPhases.end());
+    std::sort(assets.begin(), assets.end(), [](const auto& a, const auto& b) {
+        return a.second[PHASE_COUNT] > b.second[PHASE_COUNT];
+    });
+
+    report << "\nTime by asset (summed over phases, highest first)\n";
+    for (const auto& a : assets) {
+        report << "  " << std::left << std::setw((int)nameWidth) << a.first << std::right
+               << std::setw(12) << toMs(a.second[PHASE_COUNT]) << " ms  ";
+        for (int p = 0; p < PHASE_COUNT; ++p) {
+            if (a.second[p] == 0) continue;
+            report << " " << phaseName((Phase)p) << " " << std::setprecision(2) << toMs(a.second[p]) << std::setprecision(3);
+        }
+        report << "\n";
+    }
+
+    report << "\nTimeline (start ms, duration ms, thread, phase, asset)\n";
+    for (const Event& e : sorted) {
+        report << "  " << std::setw(10) << toMs(e.start) << std::setw(10) << toMs(e.end - e.start)
+               << std::setw(4) << e.thread << "  " << std::left << std::setw(18) << phaseName(e.phase)
+               << std::right << e.asset << "\n";
+    }
+
+    // ---- Chrome trace ----
+    std::ofstream trace(traceFile, std::ios::out | std::ios::trunc);
+    if (!trace) {
+        std::cerr << "[WARNING] Unable to write startup trace: " << traceFile << std::endl;
+        return false;
+    }
+    trace << std::fixed << std::setprecision(3);
+    trace << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (uint32_t t = 0; t < threads || t <= main; ++t) {
+        trace << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t << ",\"args\":{\"name\":\""
+              << (t == main ? string("main") : "worker " + std::to_string(t)) << "\"}},\n";
+    }
+    for (const Event& e : sorted) {
+        string asset = jsonEscape(e.asset);
+        trace << "{\"name\":\"" << phaseName(e.phase) << " " << asset << "\",\"cat\":\"" << phaseName(e.phase)
+              << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread << ",\"ts\":" << toUs(e.start)
+              << ",\"dur\":" << toUs(e.end - e.start) << ",\"args\":{\"asset\":\"" << asset << "\"}},\n";
+    }
+    trace << "{\"name\":\"first frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":" << main
+          << ",\"ts\":" << toUs(total) << "}\n]}\n";
+
+    std::cout << "[INFO] Startup report written to " << reportFile << " and " << traceFile << std::endl;
+    return true;
+}
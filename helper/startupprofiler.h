@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Records how long each phase of each asset load takes between process
+// start and the first frame.
+//
+// Phases are timed with Scope objects.  The asset a phase belongs to is
+// taken from the innermost AssetScope on the same thread, so deep helpers
+// (decoders, mesh processing) need no extra parameters.  Once finish() has
+// been called further scopes cost a single branch.
+//
+// writeReports() produces a plain-text summary sorted by cost and a Chrome
+// trace (chrome://tracing or ui.perfetto.dev) with one track per thread.
+class StartupProfiler {
+public:
+    enum Phase {
+        OPEN,
+        READ,
+        PARSE,
+        NORMALS_TANGENTS,
+        DEDUP,
+        DECODE,
+        UPLOAD,
+        COMPILE,
+        LINK,
+        PHASE_COUNT
+    };
+
+    // Names the asset that phases on this thread are attributed to
+    class AssetScope {
+    public:
+        explicit AssetScope(const std::string& asset);
+        ~AssetScope();
+
+        AssetScope(const AssetScope&) = delete;
+        AssetScope& operator=(const AssetScope&) = delete;
+
+    private:
+        const std::string* previous;
+        std::string name;
+    };
+
+    // Times one phase of the current asset
+    class Scope {
+    public:
+        explicit Scope(Phase phase);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Phase phase;
+        bool timing;
+        uint64_t start;
+    };
+
+    // Nanoseconds since process start
+    static uint64_t now();
+
+    // Adds a phase measured elsewhere, e.g. an asynchronous read
+    static void record(Phase phase, const std::string& asset, uint64_t start, uint64_t end);
+
+    // Marks the end of startup; later phases are not recorded
+    static void finish();
+    static bool active();
+
+    static const char* phaseName(Phase phase);
+
+    // Writes the text report and the Chrome trace JSON
+    static bool writeReports(const std::string& reportFile, const std::string& traceFile);
+};
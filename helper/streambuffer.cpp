@@ -0,0 +1,83 @@
+#include "streambuffer.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+StreamBuffer::StreamBuffer() : buffer(0), mapped(nullptr), regionSize(0), head(0), uniformAlignment(256),
+    frames(0), current(0), fences(), warned(false) {}
+
+StreamBuffer::~StreamBuffer() {
+    for (GLsync& fence : fences) {
+        if (fence) glDeleteSync(fence);
+    }
+    if (buffer) {
+        glUnmapNamedBuffer(buffer);
+        glDeleteBuffers(1, &buffer);
+    }
+}
+
+void StreamBuffer::init(size_t bytesPerFrame, int frameCount) {
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    uniformAlignment = alignment < 1 ? 1 : (size_t)alignment;
+
+    frames = frameCount < 1 ? 1 : (frameCount > MAX_FRAMES ? MAX_FRAMES : frameCount);
+    regionSize = (bytesPerFrame + uniformAlignment - 1) / uniformAlignment * uniformAlignment;
+    current = frames - 1;
+    head = regionSize;          // Nothing can be allocated before beginFrame()
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, (GLsizeiptr)(regionSize * frames), nullptr, flags);
+    mapped = static_cast<char*>(glMapNamedBufferRange(buffer, 0, (GLsizeiptr)(regionSize * frames), flags));
+    if (mapped == nullptr) {
+        std::cerr << "[ERROR] Unable to map the stream buffer" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+void StreamBuffer::beginFrame() {
+    current = (current + 1) % frames;
+    head = 0;
+
+    GLsync& fence = fences[current];
+    if (fence == nullptr) return;
+
+    // Normally signalled long ago; flush once in case it was never submitted
+    GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while (glClientWaitSync(fence, waitFlags, 1000000) == GL_TIMEOUT_EXPIRED) {
+        waitFlags = 0;
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void StreamBuffer::endFrame() {
+    if (frames == 0) return;
+    if (fences[current]) glDeleteSync(fences[current]);
+    fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate(size_t size, size_t alignment) {
+    size_t start = (head + alignment - 1) / alignment * alignment;
+    if (start + size > regionSize) {
+        if (!warned) {
+            std::cerr << "[WARNING] Stream buffer region of " << regionSize << " bytes is full" << std::endl;
+            warned = true;
+        }
+        return { nullptr, buffer, 0 };
+    }
+
+    head = start + size;
+    size_t offset = (size_t)current * regionSize + start;
+    return { mapped + offset, buffer, (GLintptr)offset };
+}
+
+bool StreamBuffer::bindUniform(GLuint binding, const void* data, size_t size) {
+    Allocation a = allocate(size, uniformAlignment);
+    if (a.data == nullptr) return false;
+    std::memcpy(a.data, data, size);
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, a.buffer, a.offset, (GLsizeiptr)size);
+    return true;
+}
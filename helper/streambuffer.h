@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Ring buffer for data written once per frame (uniform blocks, draw
+// commands, visible lists and so on).  The buffer is created with
+// glBufferStorage and stays mapped persistent and coherent, so allocations
+// are plain CPU writes into memory the GPU reads directly, with no
+// glBufferSubData copies or orphaning.
+//
+// The buffer is split into one region per frame in flight.  beginFrame()
+// moves to the next region and waits on the fence placed when that region
+// was last used, so data is never overwritten while the GPU still reads
+// it.  endFrame() places the fence.
+class StreamBuffer {
+public:
+    struct Allocation {
+        void* data;             // Write pointer, nullptr if the region is full
+        GLuint buffer;
+        GLintptr offset;        // Byte offset into buffer for binding
+    };
+
+    StreamBuffer();
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    void init(size_t bytesPerFrame, int frames = 3);
+
+    void beginFrame();
+    void endFrame();
+
+    // Space for `size` bytes in this frame's region
+    Allocation allocate(size_t size, size_t alignment = 16);
+
+    // Copies a uniform block into the ring and binds it to `binding`
+    bool bindUniform(GLuint binding, const void* data, size_t size);
+
+    template <typename T>
+    bool bindUniform(GLuint binding, const T& block) { return bindUniform(binding, &block, sizeof(T)); }
+
+    GLuint getBuffer() const { return buffer; }
+
+private:
+    static const int MAX_FRAMES = 4;
+
+    GLuint buffer;
+    char* mapped;
+    size_t regionSize;
+    size_t head;                // Next free byte in the current region
+    size_t uniformAlignment;
+    int frames;
+    int current;
+    GLsync fences[MAX_FRAMES];
+    bool warned;
+};
@@ -3,11 +3,22 @@
 #include "helper/scene.h"
 #include "helper/scenerunner.h"
 #include "scenebasic_uniform.h"
+#include "assetcooker.h"
+#include "helper/assetarchive.h"
 #include "glm/glm.hpp"
+#include <cstring>
 
 
 int main(int argc, char* argv[])
 {
+	// Offline mode: build the packed asset archive and exit
+	if (argc > 1 && std::strcmp(argv[1], "--cook") == 0)
+		return AssetCooker::run(argc - 1, argv + 1);
+
+	// Cooked assets are used when present, loose files otherwise
+	if (!AssetArchive::mount("assets.pak"))
+		std::cout << "No asset archive found, loading loose files (run with --cook to build one)" << std::endl;
+
 	SceneRunner runner("Shader_Basics");
 
 	std::unique_ptr<SceneBasic_Uniform> scene = std::make_unique<SceneBasic_Uniform>();
@@ -1,5 +1,9 @@
 #include "objmesh.h"
 #include "utils.h"
+#include "helper/assetarchive.h"
+#include "assetpreloader.h"
+#include "helper/startupprofiler.h"
+#include "helper/glstatecache.h"
 
 using std::string;
 using glm::vec3;
@@ -15,15 +19,52 @@ using std::ifstream;
 #include <sstream>
 using std::istringstream;
 #include <map>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    const char MESH_MAGIC[4] = { 'D', 'S', 'M', 'S' };
+    const uint32_t MESH_VERSION = 1;
+
+    const uint32_t MESH_HAS_TEXCOORDS = 1;
+    const uint32_t MESH_HAS_TANGENTS = 2;
+
+    struct CookedMeshHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t flags;
+        float bboxMin[3];
+        float bboxMax[3];
+        uint32_t reserved;
+        // Array offsets from the start of the payload
+        uint64_t indicesOffset;
+        uint64_t pointsOffset;
+        uint64_t normalsOffset;
+        uint64_t texCoordsOffset;
+        uint64_t tangentsOffset;
+    };
+
+    size_t align16(size_t v) { return (v + 15) & ~size_t(15); }
+
+    // Read-only istream source over a buffer that is already in memory
+    class MemoryStreamBuf : public std::streambuf {
+    public:
+        MemoryStreamBuf(const char * data, size_t size) {
+            char * p = const_cast<char *>(data);
+            setg(p, p, p + size);
+        }
+    };
+}
 
 ObjMesh::ObjMesh() : drawAdj(false)
 { }
 
 void ObjMesh::render() const {
     if( drawAdj ) {
-        glBindVertexArray(vao);
+        GLStateCache::bindVertexArray(vao);
         glDrawElements(GL_TRIANGLES_ADJACENCY, nVerts, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
     } else {
         TriangleMesh::render();
     }
@@ -31,6 +72,21 @@ void ObjMesh::render() const {
 
 
 std::unique_ptr<ObjMesh> ObjMesh::load( const char * fileName, bool center, bool genTangents ) {
+    StartupProfiler::AssetScope asset(fileName);
+
+    // Prefer the cooked copy from the asset archive when one is mounted
+    if( const AssetArchive * archive = AssetArchive::mounted() ) {
+        if( const AssetArchive::Entry * e = archive->find(fileName, AssetArchive::MESH) ) {
+            auto cooked = loadCooked(archive->data(*e), (size_t)e->size, center, genTangents, fileName);
+            if( cooked ) return cooked;
+        }
+    }
+
+    // Then a copy parsed during the startup preload
+    if( const std::vector<unsigned char> * blob = AssetPreloader::cookedMesh(fileName) ) {
+        auto cooked = loadCooked(blob->data(), blob->size(), center, genTangents, fileName);
+        if( cooked ) return cooked;
+    }
 
     std::unique_ptr<ObjMesh> mesh(new ObjMesh());
 
@@ -64,7 +120,139 @@ std::unique_ptr<ObjMesh> ObjMesh::load( const char * fileName, bool center, bool
     return mesh;
 }
 
+bool ObjMesh::cook( const char * fileName, std::vector<unsigned char> & out ) {
+    StartupProfiler::AssetScope asset(fileName);
+    ifstream objStream;
+    {
+        StartupProfiler::Scope timer(StartupProfiler::OPEN);
+        objStream.open(fileName, std::ios::in);
+    }
+    if( ! objStream ) {
+        cerr << "Unable to open OBJ file: " << fileName << endl;
+        return false;
+    }
+    if( ! cookStream(objStream, out) ) {
+        cerr << "Unable to parse OBJ file: " << fileName << endl;
+        return false;
+    }
+    return true;
+}
+
+bool ObjMesh::cookFromMemory( const char * data, size_t size, std::vector<unsigned char> & out ) {
+    MemoryStreamBuf buf(data, size);
+    std::istream objStream(&buf);
+    return cookStream(objStream, out);
+}
+
+bool ObjMesh::cookStream( std::istream & objStream, std::vector<unsigned char> & out ) {
+    Aabb bbox;
+    ObjMeshData meshData;
+    if( ! meshData.load(objStream, bbox) ) return false;
+    meshData.generateNormalsIfNeeded();
+    if( ! meshData.texCoords.empty() ) meshData.generateTangents();
+
+    GlMeshData glMesh;
+    meshData.toGlMesh(glMesh);
+
+    CookedMeshHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MESH_MAGIC, 4);
+    header.version = MESH_VERSION;
+    header.vertexCount = (uint32_t)(glMesh.points.size() / 3);
+    header.indexCount = (uint32_t)glMesh.faces.size();
+    if( ! glMesh.texCoords.empty() ) header.flags |= MESH_HAS_TEXCOORDS;
+    if( ! glMesh.tangents.empty() ) header.flags |= MESH_HAS_TANGENTS;
+    for( int i = 0; i < 3; i++ ) {
+        header.bboxMin[i] = bbox.min[i];
+        header.bboxMax[i] = bbox.max[i];
+    }
+
+    size_t offset = align16(sizeof(header));
+    header.indicesOffset = offset;   offset = align16(offset + glMesh.faces.size() * sizeof(GLuint));
+    header.pointsOffset = offset;    offset = align16(offset + glMesh.points.size() * sizeof(GLfloat));
+    header.normalsOffset = offset;   offset = align16(offset + glMesh.normals.size() * sizeof(GLfloat));
+    header.texCoordsOffset = offset; offset = align16(offset + glMesh.texCoords.size() * sizeof(GLfloat));
+    header.tangentsOffset = offset;  offset = align16(offset + glMesh.tangents.size() * sizeof(GLfloat));
+
+    out.assign(offset, 0);
+    std::memcpy(out.data(), &header, sizeof(header));
+    auto copy = [&out](uint64_t at, const void * src, size_t bytes) {
+        if( bytes > 0 ) std::memcpy(out.data() + at, src, bytes);
+    };
+    copy(header.indicesOffset, glMesh.faces.data(), glMesh.faces.size() * sizeof(GLuint));
+    copy(header.pointsOffset, glMesh.points.data(), glMesh.points.size() * sizeof(GLfloat));
+    copy(header.normalsOffset, glMesh.normals.data(), glMesh.normals.size() * sizeof(GLfloat));
+    copy(header.texCoordsOffset, glMesh.texCoords.data(), glMesh.texCoords.size() * sizeof(GLfloat));
+    copy(header.tangentsOffset, glMesh.tangents.data(), glMesh.tangents.size() * sizeof(GLfloat));
+    return true;
+}
+
+std::unique_ptr<ObjMesh> ObjMesh::loadCooked( const unsigned char * data, size_t size,
+        bool center, bool genTangents, const char * name ) {
+    StartupProfiler::AssetScope asset(name);
+    CookedMeshHeader header;
+    if( size < sizeof(header) ) return nullptr;
+    std::memcpy(&header, data, sizeof(header));
+    if( std::memcmp(header.magic, MESH_MAGIC, 4) != 0 || header.version != MESH_VERSION ) return nullptr;
+
+    // Every array has to lie inside the blob; a corrupt header must not
+    // send glBufferData past the end of the mapping
+    auto inside = [size]( uint64_t offset, uint64_t count, uint64_t stride ) {
+        return offset <= size && count <= (size - offset) / stride;
+    };
+    uint64_t vertices = header.vertexCount;
+    if( ! inside(header.indicesOffset, header.indexCount, sizeof(GLuint)) ||
+        ! inside(header.pointsOffset, vertices * 3, sizeof(GLfloat)) ||
+        ! inside(header.normalsOffset, vertices * 3, sizeof(GLfloat)) ) return nullptr;
+    if( (header.flags & MESH_HAS_TEXCOORDS) && ! inside(header.texCoordsOffset, vertices * 2, sizeof(GLfloat)) ) return nullptr;
+    if( (header.flags & MESH_HAS_TANGENTS) && ! inside(header.tangentsOffset, vertices * 4, sizeof(GLfloat)) ) return nullptr;
+
+    // Indices past the vertex arrays would make the draw read out of bounds
+    const GLuint * indices = reinterpret_cast<const GLuint *>(data + header.indicesOffset);
+    for( uint32_t i = 0; i < header.indexCount; i++ ) {
+        if( indices[i] >= header.vertexCount ) return nullptr;
+    }
+
+    // Tangents were requested but could not be cooked; let the caller parse the OBJ
+    bool hasTangents = (header.flags & MESH_HAS_TANGENTS) != 0;
+    if( genTangents && ! hasTangents ) return nullptr;
+
+    std::unique_ptr<ObjMesh> mesh(new ObjMesh());
+    for( int i = 0; i < 3; i++ ) {
+        mesh->bbox.min[i] = header.bboxMin[i];
+        mesh->bbox.max[i] = header.bboxMax[i];
+    }
+
+    const GLfloat * points = reinterpret_cast<const GLfloat *>(data + header.pointsOffset);
+
+    // Centering has to touch the positions, so only they get copied
+    std::vector<GLfloat> centered;
+    if( center ) {
+        GlMeshData glMesh;
+        glMesh.points.assign(points, points + header.vertexCount * 3);
+        glMesh.center(mesh->bbox);
+        centered.swap(glMesh.points);
+        points = centered.data();
+    }
+
+    mesh->initBuffers(
+            (GLsizei)header.indexCount, indices,
+            (GLsizei)header.vertexCount, points,
+            reinterpret_cast<const GLfloat *>(data + header.normalsOffset),
+            (header.flags & MESH_HAS_TEXCOORDS) ? reinterpret_cast<const GLfloat *>(data + header.texCoordsOffset) : nullptr,
+            (genTangents && hasTangents) ? reinterpret_cast<const GLfloat *>(data + header.tangentsOffset) : nullptr
+    );
+
+    cout << "Loaded cooked mesh: " << name
+         << " vertices = " << header.vertexCount
+         << " triangles = " << (header.indexCount / 3)
+         << endl << "    " << mesh->bbox.toString() << endl;
+
+    return mesh;
+}
+
 std::unique_ptr<ObjMesh> ObjMesh::loadWithAdjacency( const char * fileName, bool center ) {
+    StartupProfiler::AssetScope asset(fileName);
 
     std::unique_ptr<ObjMesh> mesh(new ObjMesh());
 
@@ -98,13 +286,25 @@ std::unique_ptr<ObjMesh> ObjMesh::loadWithAdjacency( const char * fileName, bool
 }
 
 void ObjMesh::ObjMeshData::load(const char * fileName, Aabb & bbox) {
-	ifstream objStream(fileName, std::ios::in);
+	ifstream objStream;
+	{
+		StartupProfiler::Scope timer(StartupProfiler::OPEN);
+		objStream.open(fileName, std::ios::in);
+	}
 
 	if (!objStream) {
 		cerr << "Unable to open OBJ file: " << fileName << endl;
 		exit(1);
 	}
 
+	if (!load(objStream, bbox)) {
+		cerr << "Unable to parse OBJ file: " << fileName << endl;
+		exit(1);
+	}
+}
+
+bool ObjMesh::ObjMeshData::load(std::istream & objStream, Aabb & bbox) {
+	StartupProfiler::Scope timer(StartupProfiler::PARSE);
 	bbox.reset();
 	string line, token;
 	getline(objStream, line);
@@ -149,18 +349,35 @@ void ObjMesh::ObjMeshData::load(const char * fileName, Aabb & bbox) {
 
 				// Triangulate as a triangle fan
 				if (parts.size() > 2) {
-					ObjVertex firstVert(parts[0], this);
-					for (int i = 2; i < parts.size(); i++) {
-						faces.push_back(firstVert);
-						faces.push_back(ObjVertex(parts[i - 1], this));
-						faces.push_back(ObjVertex(parts[i], this));
+					try {
+						ObjVertex firstVert(parts[0], this);
+						for (int i = 2; i < parts.size(); i++) {
+							faces.push_back(firstVert);
+							faces.push_back(ObjVertex(parts[i - 1], this));
+							faces.push_back(ObjVertex(parts[i], this));
+						}
+					}
+					catch (const std::logic_error &) {
+						// std::stoi on a malformed or out of range index
+						return false;
 					}
 				}
 			}
 		}
 		getline(objStream, line);
 	}
-	objStream.close();
+	return !faces.empty() && indicesValid();
+}
+
+bool ObjMesh::ObjMeshData::indicesValid() const {
+	for (const ObjVertex & v : faces) {
+		if (v.pIdx < 0 || v.pIdx >= (int)points.size()) return false;
+		// Texture coordinates and normals may only be omitted when the file has none
+		int tcMin = texCoords.empty() ? -1 : 0, nMin = normals.empty() ? -1 : 0;
+		if (v.tcIdx < tcMin || v.tcIdx >= (int)texCoords.size()) return false;
+		if (v.nIdx < nMin || v.nIdx >= (int)normals.size()) return false;
+	}
+	return true;
 }
 
 void ObjMesh::GlMeshData::center( Aabb & bbox ) {
@@ -202,6 +419,7 @@ ObjMesh::ObjMeshData::ObjVertex::ObjVertex(std::string &vertString, ObjMeshData
 
 void ObjMesh::ObjMeshData::generateNormalsIfNeeded() {
     if( normals.size() != 0 ) return;
+    StartupProfiler::Scope timer(StartupProfiler::NORMALS_TANGENTS);
 
     normals.resize(points.size());
 
@@ -230,6 +448,7 @@ void ObjMesh::ObjMeshData::generateNormalsIfNeeded() {
 }
 
 void ObjMesh::ObjMeshData::generateTangents() {
+    StartupProfiler::Scope timer(StartupProfiler::NORMALS_TANGENTS);
     std::vector<vec3> tan1Accum(points.size());
     std::vector<vec3> tan2Accum(points.size());
     tangents.resize(points.size());
@@ -278,6 +497,7 @@ void ObjMesh::ObjMeshData::generateTangents() {
 }
 
 void ObjMesh::ObjMeshData::toGlMesh(GlMeshData & data) {
+    StartupProfiler::Scope timer(StartupProfiler::DEDUP);
     data.clear();
 
     std::map<std::string, GLuint> vertexMap;
@@ -8,6 +8,7 @@
 #include <glm/glm.hpp>
 #include <string>
 #include <memory>
+#include <istream>
 
 class ObjMesh : public TriangleMesh {
 private:
@@ -17,12 +18,21 @@ public:
     static std::unique_ptr<ObjMesh> load(const char* fileName, bool center = false, bool genTangents = false);
     static std::unique_ptr<ObjMesh> loadWithAdjacency(const char* fileName, bool center = false);
 
+    // Cooked meshes: parsed, with normals generated, tangents generated when
+    // the mesh has texture coordinates, and vertices de-duplicated into GL
+    // layout.  This is the mesh payload format of the asset archive.
+    static bool cook(const char* fileName, std::vector<unsigned char>& out);
+    static bool cookFromMemory(const char* data, size_t size, std::vector<unsigned char>& out);
+    static std::unique_ptr<ObjMesh> loadCooked(const unsigned char* data, size_t size,
+        bool center, bool genTangents, const char* name);
+
     void render() const override;
 
     const Aabb& getBoundingBox() const { return bbox; }
 
 protected:
     ObjMesh();
+    static bool cookStream(std::istream& objStream, std::vector<unsigned char>& out);
     Aabb bbox;  // Bounding Box
 
     class GlMeshData {
@@ -70,6 +80,8 @@ protected:
         void generateNormalsIfNeeded();
         void generateTangents();
         void load(const char* fileName, Aabb& bbox);
+        bool load(std::istream& objStream, Aabb& bbox);
+        bool indicesValid() const;
         void toGlMesh(GlMeshData& data);
     };
 };
@@ -0,0 +1,237 @@
+#include "occlusionculler.h"
+#include "helper/cpufeatures.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <immintrin.h>
+
+namespace {
+    // Anything this close to the eye (or behind it) is not rasterized as an
+    // occluder and is always treated as visible as an occludee
+    const float NEAR_W = 1.0f;
+
+    struct ScreenVertex {
+        float x, y;     // Pixels
+        float invW;
+    };
+
+    bool project(const glm::mat4& viewProjection, const glm::vec3& p, ScreenVertex& out) {
+        glm::vec4 clip = viewProjection * glm::vec4(p, 1.0f);
+        if (clip.w < NEAR_W) return false;
+        out.invW = 1.0f / clip.w;
+        out.x = (clip.x * out.invW * 0.5f + 0.5f) * OcclusionCuller::WIDTH;
+        out.y = (clip.y * out.invW * 0.5f + 0.5f) * OcclusionCuller::HEIGHT;
+        return true;
+    }
+
+    // Edge function A*x + B*y + C, positive on the inside of a
+    // counter-clockwise triangle
+    struct Edge {
+        float a, b, c;
+
+        Edge(const ScreenVertex& from, const ScreenVertex& to) {
+            a = -(to.y - from.y);
+            b = to.x - from.x;
+            c = (to.y - from.y) * from.x - (to.x - from.x) * from.y;
+        }
+    };
+
+    void rasterizeScalar(float* depth, const ScreenVertex* v, float invArea, int minX, int maxX, int minY, int maxY) {
+        Edge e0(v[1], v[2]), e1(v[2], v[0]), e2(v[0], v[1]);
+        for (int y = minY; y <= maxY; ++y) {
+            float py = y + 0.5f;
+            float* row = depth + y * OcclusionCuller::WIDTH;
+            for (int x = minX; x <= maxX; ++x) {
+                float px = x + 0.5f;
+                float w0 = e0.a * px + e0.b * py + e0.c;
+                float w1 = e1.a * px + e1.b * py + e1.c;
+                float w2 = e2.a * px + e2.b * py + e2.c;
+                if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+                float invW = (w0 * v[0].invW + w1 * v[1].invW + w2 * v[2].invW) * invArea;
+                row[x] = std::max(row[x], invW);
+            }
+        }
+    }
+
+    CPU_TARGET("avx2,fma")
+    void rasterizeAvx2(float* depth, const ScreenVertex* v, float invArea, int minX, int maxX, int minY, int maxY) {
+        Edge e0(v[1], v[2]), e1(v[2], v[0]), e2(v[0], v[1]);
+        const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+        const __m256 a0 = _mm256_set1_ps(e0.a), a1 = _mm256_set1_ps(e1.a), a2 = _mm256_set1_ps(e2.a);
+        // Barycentric weights pre-scaled so their sum is 1/w directly
+        const __m256 z0 = _mm256_set1_ps(v[0].invW * invArea);
+        const __m256 z1 = _mm256_set1_ps(v[1].invW * invArea);
+        const __m256 z2 = _mm256_set1_ps(v[2].invW * invArea);
+        const __m256 zero = _mm256_setzero_ps();
+
+        int startX = minX & ~7;
+        for (int y = minY; y <= maxY; ++y) {
+            float py = y + 0.5f;
+            __m256 r0 = _mm256_set1_ps(e0.b * py + e0.c);
+            __m256 r1 = _mm256_set1_ps(e1.b * py + e1.c);
+            __m256 r2 = _mm256_set1_ps(e2.b * py + e2.c);
+            float* row = depth + y * OcclusionCuller::WIDTH;
+
+            for (int x = startX; x <= maxX; x += 8) {
+                __m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffsets);
+                __m256 w0 = _mm256_fmadd_ps(a0, px, r0);
+                __m256 w1 = _mm256_fmadd_ps(a1, px, r1);
+                __m256 w2 = _mm256_fmadd_ps(a2, px, r2);
+                __m256 inside = _mm256_cmp_ps(_mm256_min_ps(w0, _mm256_min_ps(w1, w2)), zero, _CMP_GE_OQ);
+                if (_mm256_testz_ps(inside, inside)) continue;
+
+                __m256 invW = _mm256_fmadd_ps(w0, z0, _mm256_fmadd_ps(w1, z1, _mm256_mul_ps(w2, z2)));
+                __m256 old = _mm256_loadu_ps(row + x);
+                __m256 nearer = _mm256_max_ps(old, invW);
+                _mm256_storeu_ps(row + x, _mm256_blendv_ps(old, nearer, inside));
+            }
+        }
+    }
+
+    // True if any pixel of the rectangle is no nearer than invW
+    bool anyBehindScalar(const float* depth, float invW, int minX, int maxX, int minY, int maxY) {
+        for (int y = minY; y <= maxY; ++y) {
+            const float* row = depth + y * OcclusionCuller::WIDTH;
+            for (int x = minX; x <= maxX; ++x) {
+                if (row[x] <= invW) return true;
+            }
+        }
+        return false;
+    }
+
+    CPU_TARGET("avx2,fma")
+    bool anyBehindAvx2(const float* depth, float invW, int minX, int maxX, int minY, int maxY) {
+        const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i first = _mm256_set1_epi32(minX - 1);
+        const __m256i last = _mm256_set1_epi32(maxX + 1);
+        const __m256 value = _mm256_set1_ps(invW);
+
+        int startX = minX & ~7;
+        for (int y = minY; y <= maxY; ++y) {
+            const float* row = depth + y * OcclusionCuller::WIDTH;
+            for (int x = startX; x <= maxX; x += 8) {
+                // Only the lanes inside [minX, maxX] count
+                __m256i column = _mm256_add_epi32(_mm256_set1_epi32(x), lanes);
+                __m256i inRange = _mm256_and_si256(_mm256_cmpgt_epi32(column, first), _mm256_cmpgt_epi32(last, column));
+                __m256 open = _mm256_cmp_ps(_mm256_loadu_ps(row + x), value, _CMP_LE_OQ);
+                if (!_mm256_testz_ps(open, _mm256_castsi256_ps(inRange))) return true;
+            }
+        }
+        return false;
+    }
+
+    const int BOX_TRIANGLES[12][3] = {
+        { 0, 1, 3 }, { 0, 3, 2 }, { 4, 6, 7 }, { 4, 7, 5 },
+        { 0, 4, 5 }, { 0, 5, 1 }, { 2, 3, 7 }, { 2, 7, 6 },
+        { 0, 2, 6 }, { 0, 6, 4 }, { 1, 5, 7 }, { 1, 7, 3 }
+    };
+}
+
+OcclusionCuller::OcclusionCuller() :
+    worker(1),
+    pending(false),
+    jobStats{ 0, 0, 0, 0.0, "scalar" },
+    depth(WIDTH * HEIGHT, 0.0f),
+    lastStats{ 0, 0, 0, 0.0, "scalar" }
+{
+}
+
+OcclusionCuller::~OcclusionCuller() {
+    worker.wait();
+}
+
+void OcclusionCuller::begin(const glm::mat4& viewProjection, std::vector<OrientedBox> occluders,
+    std::vector<Occludee> occludees) {
+    if (pending) worker.wait();
+
+    jobViewProjection = viewProjection;
+    jobOccluders = std::move(occluders);
+    jobOccludees = std::move(occludees);
+    pending = true;
+    worker.submit([this]() { run(); });
+}
+
+bool OcclusionCuller::finish(std::vector<uint32_t>& hidden) {
+    if (!pending) return false;
+    worker.wait();
+    pending = false;
+
+    hidden.swap(jobHidden);
+    lastStats = jobStats;
+    return true;
+}
+
+void OcclusionCuller::run() {
+    auto start = std::chrono::steady_clock::now();
+    bool avx2 = CpuFeatures::hasAvx2();
+
+    std::fill(depth.begin(), depth.end(), 0.0f);
+    for (const OrientedBox& box : jobOccluders) drawBox(box, avx2);
+
+    jobHidden.clear();
+    for (const Occludee& o : jobOccludees) {
+        if (isHidden(o, avx2)) jobHidden.push_back(o.index);
+    }
+
+    jobStats.occluders = jobOccluders.size();
+    jobStats.tested = jobOccludees.size();
+    jobStats.occluded = jobHidden.size();
+    jobStats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    jobStats.path = avx2 ? "AVX2" : "scalar";
+}
+
+void OcclusionCuller::drawBox(const OrientedBox& box, bool avx2) {
+    ScreenVertex corners[8];
+    for (int i = 0; i < 8; ++i) {
+        glm::vec3 p = box.center +
+            ((i & 1) ? box.axes[0] : -box.axes[0]) +
+            ((i & 2) ? box.axes[1] : -box.axes[1]) +
+            ((i & 4) ? box.axes[2] : -box.axes[2]);
+        // A box crossing the near plane would need clipping; skipping it
+        // only loses occlusion
+        if (!project(jobViewProjection, p, corners[i])) return;
+    }
+
+    for (const int* t : BOX_TRIANGLES) {
+        ScreenVertex v[3] = { corners[t[0]], corners[t[1]], corners[t[2]] };
+        float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+        if (std::fabs(area) < 1e-6f) continue;
+        if (area < 0.0f) {
+            std::swap(v[1], v[2]);
+            area = -area;
+        }
+
+        int minX = std::max(0, (int)std::floor(std::min({ v[0].x, v[1].x, v[2].x })));
+        int maxX = std::min(WIDTH - 1, (int)std::ceil(std::max({ v[0].x, v[1].x, v[2].x })));
+        int minY = std::max(0, (int)std::floor(std::min({ v[0].y, v[1].y, v[2].y })));
+        int maxY = std::min(HEIGHT - 1, (int)std::ceil(std::max({ v[0].y, v[1].y, v[2].y })));
+        if (minX > maxX || minY > maxY) continue;
+
+        if (avx2) rasterizeAvx2(depth.data(), v, 1.0f / area, minX, maxX, minY, maxY);
+        else rasterizeScalar(depth.data(), v, 1.0f / area, minX, maxX, minY, maxY);
+    }
+}
+
+bool OcclusionCuller::isHidden(const Occludee& o, bool avx2) const {
+    // Screen rectangle and nearest depth of the sphere's bounding box
+    float minX = 1e30f, maxX = -1e30f, minY = 1e30f, maxY = -1e30f, nearest = 0.0f;
+    for (int i = 0; i < 8; ++i) {
+        glm::vec3 p = o.center + glm::vec3((i & 1) ? o.radius : -o.radius,
+            (i & 2) ? o.radius : -o.radius, (i & 4) ? o.radius : -o.radius);
+        ScreenVertex s;
+        if (!project(jobViewProjection, p, s)) return false;
+        minX = std::min(minX, s.x);
+        maxX = std::max(maxX, s.x);
+        minY = std::min(minY, s.y);
+        maxY = std::max(maxY, s.y);
+        nearest = std::max(nearest, s.invW);
+    }
+
+    int x0 = std::max(0, (int)std::floor(minX)), x1 = std::min(WIDTH - 1, (int)std::ceil(maxX) - 1);
+    int y0 = std::max(0, (int)std::floor(minY)), y1 = std::min(HEIGHT - 1, (int)std::ceil(maxY) - 1);
+    if (x0 > x1 || y0 > y1) return false;
+
+    if (avx2) return !anyBehindAvx2(depth.data(), nearest, x0, x1, y0, y1);
+    return !anyBehindScalar(depth.data(), nearest, x0, x1, y0, y1);
+}
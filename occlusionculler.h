@@ -0,0 +1,78 @@
+#pragma once
+
+#include "helper/threadpool.h"
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Software occlusion culling.  Occluders are drawn as boxes into a small
+// CPU depth buffer, eight pixels at a time with AVX2, and each occludee's
+// screen rectangle is then tested against it: an occludee is hidden when
+// every pixel under its rectangle already holds something nearer.
+//
+// Occluder boxes must lie inside the object they stand for, so the buffer
+// never claims more coverage than the real geometry.  Depth is stored as
+// 1/w, which interpolates linearly across the screen; larger is nearer and
+// the buffer clears to 0 (infinitely far).
+//
+// The work runs on a worker thread.  begin() hands over one frame's
+// occluders and occludees and returns at once; finish() collects the
+// result, normally a frame later, so the rasterizer overlaps the rest of
+// the frame and the next update.
+class OcclusionCuller {
+public:
+    static const int WIDTH = 256;
+    static const int HEIGHT = 128;
+
+    // A box given by its centre and three half-axis vectors
+    struct OrientedBox {
+        glm::vec3 center;
+        glm::vec3 axes[3];
+    };
+
+    struct Occludee {
+        uint32_t index;        // Caller's id, returned if hidden
+        glm::vec3 center;
+        float radius;
+    };
+
+    struct Stats {
+        size_t occluders;      // Boxes drawn
+        size_t tested;         // Occludees tested
+        size_t occluded;       // Occludees found hidden
+        double milliseconds;   // Worker time for the job
+        const char* path;      // "AVX2" or "scalar"
+    };
+
+    OcclusionCuller();
+    ~OcclusionCuller();
+
+    // Starts a job; waits for any job still running first
+    void begin(const glm::mat4& viewProjection, std::vector<OrientedBox> occluders,
+        std::vector<Occludee> occludees);
+
+    // Waits for the last job and returns the ids it found hidden.  Returns
+    // false if no job was started since the last call.
+    bool finish(std::vector<uint32_t>& hidden);
+
+    const Stats& stats() const { return lastStats; }
+
+private:
+    ThreadPool worker;
+    bool pending;
+
+    // Owned by the worker while a job runs
+    glm::mat4 jobViewProjection;
+    std::vector<OrientedBox> jobOccluders;
+    std::vector<Occludee> jobOccludees;
+    std::vector<uint32_t> jobHidden;
+    Stats jobStats;
+
+    std::vector<float> depth;  // WIDTH * HEIGHT values of 1/w
+    Stats lastStats;
+
+    void run();
+    void drawBox(const OrientedBox& box, bool avx2);
+    bool isHidden(const Occludee& occludee, bool avx2) const;
+};
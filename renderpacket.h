@@ -0,0 +1,43 @@
+#ifndef RENDERPACKET_H
+#define RENDERPACKET_H
+
+#include "Asteroid.h"
+
+#include <glm/glm.hpp>
+
+// Everything render() reads from the simulation, copied by the game thread
+// once the frame's update is done.  The render thread draws from it while
+// the game thread moves on to the next frame, so nothing in it may be
+// shared with state the game thread still writes.
+struct RenderPacket {
+    float time;                 // Seconds since start
+    float deltaTime;
+
+    // Ship
+    glm::vec3 shipPosition;
+    glm::vec3 shipDirection;
+
+    // Orbiting key light
+    float lightOrbitAngle;
+    float lightVerticalOffset;
+    float lightRadiusOffset;
+
+    // Collision feedback
+    glm::vec3 flashPosition;    // Where the last collision happened
+    float flashAge;             // Seconds since then
+    float damageEffect;         // Red tint strength for the tone-mapping pass
+
+    bool depthPrepass;
+
+    // Frame capture
+    bool screenshot;            // Save this frame
+    bool recording;             // Whether a recording should be running
+
+    bool gpuProfiling;
+
+    // Asteroids to cull and draw; the list is shared, not copied, while it
+    // stays the same
+    AsteroidManager::Frame asteroids;
+};
+
+#endif // RENDERPACKET_H
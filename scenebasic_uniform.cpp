@@ -8,6 +8,8 @@
 #include "ShipController.h"
 #include "Asteroid.h"
 #include "CollisionDetection.h"
+#include "assetpreloader.h"
+#include "helper/glstatecache.h"
 
 using std::cerr;
 using std::endl;
@@ -15,7 +17,97 @@ using glm::vec3;
 using glm::mat4;
 using glm::mat3;
 
+namespace {
+    // Startup assets, shared by the preload list and the loads below
+    const char* const SHIP_MESH = "media/models/7345nq347b.obj";
+    const char* const ASTEROID_MESH = "media/models/LPP.obj";
+    const char* const SKYBOX_BASE = "media/textures/skybox/nebula";
+    const char* const SHIP_ALBEDO = "media/textures/spaceship textures/7345nq347b_albedo.png";
+    const char* const SHIP_NORMAL = "media/textures/spaceship textures/7345nq347b_normal.png";
+    const char* const SHIP_METALNESS = "media/textures/spaceship textures/7345nq347b_metalness.png";
+    const char* const SHIP_ROUGHNESS = "media/textures/spaceship textures/7345nq347b_roughness.png";
+    const char* const SHIP_AO = "media/textures/spaceship textures/7345nq347b_ao.png";
+    const char* const ASTEROID_ALBEDO = "media/textures/Astroid Textures/LPP_1001_BaseColor.png";
+    const char* const ASTEROID_NORMAL = "media/textures/Astroid Textures/LPP_1001_Normal.png";
+    const char* const SHADERS[] = {
+        "shader/basic_uniform.vert", "shader/basic_uniform.frag",
+        "shader/astroid.vert", "shader/astroid.frag",
+        "shader/impostor.vert", "shader/impostor.frag", "shader/impostor_bake.vert", "shader/impostor_bake.frag",
+        "shader/skybox.vert", "shader/skybox.frag",
+        "shader/hdr.vert", "shader/taa.frag", "shader/present.frag", "shader/depth_only.frag",
+        "shader/asteroid_cull.comp", "shader/light_cull.comp", "shader/postprocess.comp", "shader/exposure.comp",
+        "shader/common/vertex_inputs.glsl", "shader/common/frame_data.glsl", "shader/common/motion.glsl",
+        "shader/common/clustered_lights.glsl",
+        "shader/common/asteroid_instance.glsl", "shader/common/asteroid_shading.glsl",
+        "shader/common/impostor.glsl", "shader/common/exposure.glsl",
+        "shader/common/lighting.glsl", "shader/common/pbr.glsl"
+    };
+
+    // Depth range split into light cluster slices; the far end is the
+    // camera's far plane
+    const float CLUSTER_NEAR_DEPTH = 50.0f;
+    const float CLUSTER_FAR_DEPTH = 50000.0f;
+
+    // Collision flash light
+    const float FLASH_DURATION = 1.0f;
+
+    // GPU time the render scale aims for, just under a 60 Hz frame
+    const float FRAME_BUDGET_MS = 15.0f;
+    const float MIN_RENDER_SCALE = 0.5f;
+
+    // TAA rebuilds full resolution, so at most about half the pixels are
+    // shaded even when the budget is met
+    const float MAX_RENDER_SCALE = 0.71f;
+
+    // Render target formats.  Alpha is never used, so HDR colour packs
+    // into 32 bits, half the bandwidth of RGBA16F; depth uses the packed
+    // depth-stencil format GPUs store natively
+    const GLenum HDR_FORMAT = GL_R11F_G11F_B10F;
+    const GLenum DEPTH_FORMAT = GL_DEPTH24_STENCIL8;
+
+    // Jitter pattern length; Halton(2, 3) covers a pixel evenly in 8 frames
+    const unsigned JITTER_SAMPLES = 8;
+
+    // Element of the Halton sequence with the given base, in [0, 1)
+    float halton(unsigned index, unsigned base) {
+        float result = 0.0f;
+        float fraction = 1.0f;
+        while (index > 0) {
+            fraction /= base;
+            result += fraction * (index % base);
+            index /= base;
+        }
+        return result;
+    }
+
+    // Per-frame stream region: uniform blocks, draw commands and visible lists
+    const size_t FRAME_STREAM_SIZE = 256 * 1024;
+
+    // Issues every startup read in one batch so decoding overlaps the disk
+    void preloadAssets() {
+        std::vector<AssetPreloader::Request> requests = {
+            { SHIP_MESH, AssetPreloader::MESH },
+            { ASTEROID_MESH, AssetPreloader::MESH },
+            { SHIP_ALBEDO, AssetPreloader::TEXTURE },
+            { SHIP_NORMAL, AssetPreloader::TEXTURE },
+            { SHIP_METALNESS, AssetPreloader::TEXTURE },
+            { SHIP_ROUGHNESS, AssetPreloader::TEXTURE },
+            { SHIP_AO, AssetPreloader::TEXTURE },
+            { ASTEROID_ALBEDO, AssetPreloader::TEXTURE },
+            { ASTEROID_NORMAL, AssetPreloader::TEXTURE }
+        };
+        for (const char* face : { "posx", "negx", "posy", "negy", "posz", "negz" }) {
+            requests.push_back({ std::string(SKYBOX_BASE) + "_" + face + ".png", AssetPreloader::CUBE_FACE });
+        }
+        for (const char* shader : SHADERS) {
+            requests.push_back({ shader, AssetPreloader::SHADER });
+        }
+        AssetPreloader::preload(requests);
+    }
+}
+
 SceneBasic_Uniform::SceneBasic_Uniform() :
+    prog(nullptr),
     sky(100.0f),
     prevTime(0.0f),
     zoomFactor(90.0f),
@@ -30,72 +122,85 @@ SceneBasic_Uniform::SceneBasic_Uniform() :
     lightRadiusSpeed(0.2f),
     lightRadius(800.0f),
     lightIntensity(2.0f),
-    asteroidManager(&astroidProgram),
+    clusteredLighting(&lightCullProgram),
+    flashPosition(0.0f),
+    flashAge(FLASH_DURATION),
+    shipFeatures(SHIP_CHROMATIC_ABERRATION | SHIP_ENVIRONMENT_REFLECTIONS),
+    cullKeyDown(false),
+    cullStatsTimer(0.0f),
+    depthPrepass(true),
+    prepassKeyDown(false),
+    drawnPrepass(true),
+    prepassTiming{},
+    packets{},
+    packet(&packets[0]),
+    postProcessing(&postProgram, &exposureProgram),
+    renderWidth(0),
+    renderHeight(0),
+    historyTextures{ 0, 0 },
+    historyIndex(0),
+    historyValid(false),
+    jitterIndex(0),
+    jitter(0.0f),
+    screenshotRequested(false),
+    recording(false),
+    screenshotKeyDown(false),
+    recordKeyDown(false),
+    drawnRecording(false),
+    gpuProfiling(false),
+    profileKeyDown(false),
+    asteroidManager({ &astroidProgram, &asteroidFadeProgram, &asteroidDepthProgram, &asteroidCullProgram,
+        &impostorProgram, &impostorBakeProgram }),
     collisionDetected(false),
     timeSinceLastCollision(0.0f),
     collisionCooldown(1.5f),
     shipHealth(100)
 {
-    mesh = ObjMesh::load("media/models/7345nq347b.obj", true);
+    preloadAssets();
+
+    mesh = ObjMesh::load(SHIP_MESH, true);
     if (!mesh) {
         cerr << "[ERROR] Failed to load model!" << endl;
         exit(EXIT_FAILURE);
     }
 
-    astroidMesh = ObjMesh::load("media/models/LPP.obj", true);
+    astroidMesh = ObjMesh::load(ASTEROID_MESH, true);
     if (!astroidMesh) {
         cerr << "[ERROR] Failed to load LPP model!" << endl;
         exit(EXIT_FAILURE);
     }
     model = mat4(1.0f);
+    prevModel = model;
+    prevViewProjection = mat4(1.0f);
 }
 
 void SceneBasic_Uniform::initScene() {
     compile();
+    frameStream.init(FRAME_STREAM_SIZE);
+    clusteredLighting.initialize();
+    postProcessing.initialize();
+    dynamicResolution.init(FRAME_BUDGET_MS, MIN_RENDER_SCALE, MAX_RENDER_SCALE);
+    createHistory();
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LEQUAL);
 
-    // Set up HDR framebuffer
-    glGenFramebuffers(1, &hdrFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-
-    // Create floating point color buffer
-    glGenTextures(1, &hdrColorBuffer);
-    glBindTexture(GL_TEXTURE_2D, hdrColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, hdrColorBuffer, 0);
-
-    // Create depth buffer (renderbuffer)
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "Framebuffer not complete!" << std::endl;
-        exit(1);
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
     // Load skybox cubemap
-    skyboxTex = Texture::loadCubeMap("media/textures/skybox/nebula");
+    skyboxTex = Texture::loadCubeMap(SKYBOX_BASE);
     if (skyboxTex == GLuint(0)) {
         cerr << "[ERROR] Skybox texture failed to load!" << endl;
         exit(EXIT_FAILURE);
     }
 
     // Load PBR material textures
-    albedoMap = Texture::loadTexture("media/textures/spaceship textures/7345nq347b_albedo.png");
-    normalMap = Texture::loadTexture("media/textures/spaceship textures/7345nq347b_normal.png");
-    metallicMap = Texture::loadTexture("media/textures/spaceship textures/7345nq347b_metalness.png");
-    roughnessMap = Texture::loadTexture("media/textures/spaceship textures/7345nq347b_roughness.png");
-    aoMap = Texture::loadTexture("media/textures/spaceship textures/7345nq347b_ao.png");
+    albedoMap = Texture::loadTexture(SHIP_ALBEDO);
+    normalMap = Texture::loadTexture(SHIP_NORMAL);
+    metallicMap = Texture::loadTexture(SHIP_METALNESS);
+    roughnessMap = Texture::loadTexture(SHIP_ROUGHNESS);
+    aoMap = Texture::loadTexture(SHIP_AO);
 
     // Load asteroid textures
-    astroidAlbedoMap = Texture::loadTexture("media/textures/Astroid Textures/LPP_1001_BaseColor.png");
-    astroidNormalMap = Texture::loadTexture("media/textures/Astroid Textures/LPP_1001_Normal.png");
+    astroidAlbedoMap = Texture::loadTexture(ASTEROID_ALBEDO);
+    astroidNormalMap = Texture::loadTexture(ASTEROID_NORMAL);
 
     // Error check for ship textures
     if (albedoMap == GLuint(0) || normalMap == GLuint(0) || metallicMap == GLuint(0) ||
@@ -105,10 +210,7 @@ void SceneBasic_Uniform::initScene() {
     }
 
     // Initialize the AsteroidManager
-    if (asteroidManager.initialize(
-        "media/models/LPP.obj",
-        "media/textures/Astroid Textures/LPP_1001_BaseColor.png",
-        "media/textures/Astroid Textures/LPP_1001_Normal.png")) {
+    if (asteroidManager.initialize(ASTEROID_MESH, ASTEROID_ALBEDO, ASTEROID_NORMAL)) {
 
         // Generate static asteroid field
         glm::vec3 asteroidFieldCenter = glm::vec3(2500.0f, 2000.0f, 2500.0f);
@@ -120,6 +222,7 @@ void SceneBasic_Uniform::initScene() {
 
     // Initialize collision detection system
     Aabb modelBBox = mesh->getBoundingBox();
+    currentModelRadius = glm::length(modelBBox.max - modelBBox.min) * 0.5f;
 
     // Use the same scale factor that's used for rendering (100.0f)
     float modelVisualScale = 100.0f;
@@ -138,6 +241,12 @@ void SceneBasic_Uniform::initScene() {
     collisionSystem.setCollisionCallback([this](const Asteroid& asteroid) {
         this->handleCollision(asteroid);
         });
+
+    // Every startup load has been served; drop the preloaded copies
+    AssetPreloader::clear();
+
+    // Loading bound textures and arrays directly
+    GLStateCache::invalidate();
 }
 
 
@@ -146,7 +255,7 @@ void SceneBasic_Uniform::update(float t) {
     prevTime = t;
 
     // Handle ship movement
-    shipController.handleInput(glfwGetCurrentContext(), deltaTime);
+    shipController.handleInput(window, deltaTime);
 
     // Update light orbit angle
     lightOrbitAngle += lightOrbitSpeed * deltaTime;
@@ -158,12 +267,44 @@ void SceneBasic_Uniform::update(float t) {
     // Create smooth radius variation for light using cosine wave
     lightRadiusOffset = cos(t * lightRadiusSpeed) * currentModelRadius * 2.0f;
 
+    flashAge += deltaTime;
+
     // Update asteroids (only rotation, not position)
     asteroidManager.update(deltaTime, glm::vec3(0.0f));
 
     // Update collision detection system
     collisionSystem.update(deltaTime);
 
+    // C switches asteroid culling between the GPU and the CPU
+    bool cullKey = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+    if (cullKey && !cullKeyDown) {
+        asteroidManager.setCpuCulling(!asteroidManager.isCpuCulling());
+        std::cout << "[INFO] Asteroid culling on the " << (asteroidManager.isCpuCulling() ? "CPU" : "GPU") << std::endl;
+    }
+    cullKeyDown = cullKey;
+
+    // P toggles the depth pre-pass; the render thread reports the GPU time
+    // of both modes once it draws the change
+    bool prepassKey = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+    if (prepassKey && !prepassKeyDown) {
+        depthPrepass = !depthPrepass;
+        std::cout << "[INFO] Depth pre-pass " << (depthPrepass ? "on" : "off") << std::endl;
+    }
+    prepassKeyDown = prepassKey;
+
+    // F12 saves a screenshot and F9 toggles recording
+    bool screenshotKey = glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS;
+    if (screenshotKey && !screenshotKeyDown) screenshotRequested = true;
+    screenshotKeyDown = screenshotKey;
+    bool recordKey = glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS;
+    if (recordKey && !recordKeyDown) recording = !recording;
+    recordKeyDown = recordKey;
+
+    // G toggles the GPU profiler
+    bool profileKey = glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS;
+    if (profileKey && !profileKeyDown) gpuProfiling = !gpuProfiling;
+    profileKeyDown = profileKey;
+
     // Sync collision state with collision system if needed
     if (collisionSystem.hasCollision() && !collisionDetected) {
         collisionDetected = true;
@@ -181,31 +322,127 @@ void SceneBasic_Uniform::update(float t) {
 }
 
 
+void SceneBasic_Uniform::writePacket(int slot) {
+    // Slots are written in turn, so the previous frame is in the one before
+    RenderPacket& out = packets[slot];
+    out.deltaTime = prevTime - packets[(slot + RenderThread::SLOTS - 1) % RenderThread::SLOTS].time;
+    out.time = prevTime;
+    out.shipPosition = shipController.getPosition();
+    out.shipDirection = shipController.getDirection();
+    out.lightOrbitAngle = lightOrbitAngle;
+    out.lightVerticalOffset = lightVerticalOffset;
+    out.lightRadiusOffset = lightRadiusOffset;
+    out.flashPosition = flashPosition;
+    out.flashAge = flashAge;
+
+    // Red flash intensity based on how recent the collision was
+    if (collisionDetected && timeSinceLastCollision < 0.3f) {
+        out.damageEffect = 0.5f * (0.3f - timeSinceLastCollision) / 0.3f;
+    }
+    else {
+        out.damageEffect = 0.0f;
+    }
+
+    out.depthPrepass = depthPrepass;
+    out.screenshot = screenshotRequested;
+    out.recording = recording;
+    screenshotRequested = false;
+    out.gpuProfiling = gpuProfiling;
+    out.asteroids = asteroidManager.publish();
+}
+
+void SceneBasic_Uniform::readPacket(int slot) {
+    packet = &packets[slot];
+}
+
 void SceneBasic_Uniform::compile() {
     try {
-        // Compile and link model shader
-        prog.compileShader("shader/basic_uniform.vert");
-        prog.compileShader("shader/basic_uniform.frag");
-        prog.link();
-        prog.findUniformLocations();
-
-        // Compile and link asteroid shader
+        // Model shader; camera and light come from the FrameData block
+        shipShaders.addStage("shader/basic_uniform.vert");
+        shipShaders.addStage("shader/basic_uniform.frag");
+        shipShaders.addFeature(SHIP_CHROMATIC_ABERRATION, "CHROMATIC_ABERRATION");
+        shipShaders.addFeature(SHIP_ENVIRONMENT_REFLECTIONS, "ENVIRONMENT_REFLECTIONS");
+        shipShaders.addFeature(SHIP_NORMAL_MAPPING, "NORMAL_MAPPING");
+        shipShaders.define("CHROMATIC_ABERRATION_STRENGTH", 0.05f);
+        ClusteredLighting::defineConstants(shipShaders);
+
+        // Asteroid shader, lit much more dimly than the ship
+        astroidProgram.define("LIGHT_INTENSITY_SCALE", 0.005f);
+        ClusteredLighting::defineConstants(astroidProgram);
         astroidProgram.compileShader("shader/astroid.vert");
         astroidProgram.compileShader("shader/astroid.frag");
-        astroidProgram.link();
-        astroidProgram.findUniformLocations();
 
-        // Compile and link skybox shader
+        // The same for the last mesh level, dithered out as the impostors
+        // take over, and the impostors themselves
+        asteroidFadeProgram.define("IMPOSTOR_FADE");
+        asteroidFadeProgram.define("LIGHT_INTENSITY_SCALE", 0.005f);
+        ClusteredLighting::defineConstants(asteroidFadeProgram);
+        AsteroidImpostors::defineConstants(asteroidFadeProgram);
+        asteroidFadeProgram.compileShader("shader/astroid.vert");
+        asteroidFadeProgram.compileShader("shader/astroid.frag");
+        impostorProgram.define("LIGHT_INTENSITY_SCALE", 0.005f);
+        ClusteredLighting::defineConstants(impostorProgram);
+        AsteroidImpostors::defineConstants(impostorProgram);
+        impostorProgram.compileShader("shader/impostor.vert");
+        impostorProgram.compileShader("shader/impostor.frag");
+        ClusteredLighting::defineConstants(impostorBakeProgram);
+        AsteroidImpostors::defineConstants(impostorBakeProgram);
+        impostorBakeProgram.compileShader("shader/impostor_bake.vert");
+        impostorBakeProgram.compileShader("shader/impostor_bake.frag");
+
+        // Depth-only builds of the ship and asteroid vertex shaders
+        shipDepthProgram.define("DEPTH_ONLY");
+        shipDepthProgram.compileShader("shader/basic_uniform.vert");
+        shipDepthProgram.compileShader("shader/depth_only.frag");
+        asteroidDepthProgram.define("DEPTH_ONLY");
+        asteroidDepthProgram.compileShader("shader/astroid.vert");
+        asteroidDepthProgram.compileShader("shader/depth_only.frag");
+
+        // Asteroid culling and LOD selection
+        asteroidCullProgram.define("MAX_LODS", std::to_string(AsteroidCuller::MAX_LODS));
+        asteroidCullProgram.compileShader("shader/asteroid_cull.comp");
+
+        // Light cluster assignment
+        ClusteredLighting::defineConstants(lightCullProgram);
+        lightCullProgram.compileShader("shader/light_cull.comp");
+
+        // Skybox shader
         skyboxProgram.compileShader("shader/skybox.vert");
         skyboxProgram.compileShader("shader/skybox.frag");
-        skyboxProgram.link();
-        skyboxProgram.findUniformLocations();
 
-        // Compile and link HDR shader
-        hdrProgram.compileShader("shader/hdr.vert");
-        hdrProgram.compileShader("shader/hdr.frag");
-        hdrProgram.link();
-        hdrProgram.findUniformLocations();
+        // Post-processing and auto-exposure
+        PostProcessing::defineConstants(postProgram);
+        postProgram.compileShader("shader/postprocess.comp");
+        PostProcessing::defineConstants(exposureProgram);
+        exposureProgram.compileShader("shader/exposure.comp");
+        presentProgram.compileShader("shader/hdr.vert");
+        presentProgram.compileShader("shader/present.frag");
+
+        // Temporal upsampling, drawn with the same fullscreen quad
+        taaProgram.compileShader("shader/hdr.vert");
+        taaProgram.compileShader("shader/taa.frag");
+
+        // Start every program (cached binary or compile) before waiting on
+        // any, so the driver can build them in parallel
+        shipShaders.prepare(shipFeatures);
+        GLSLProgram* programs[] = { &astroidProgram, &asteroidFadeProgram, &asteroidDepthProgram, &asteroidCullProgram,
+            &impostorProgram, &impostorBakeProgram, &shipDepthProgram, &lightCullProgram, &skyboxProgram, &taaProgram,
+            &postProgram, &exposureProgram, &presentProgram };
+        for (GLSLProgram* p : programs) p->linkAsync();
+        for (GLSLProgram* p : programs) {
+            p->link();
+            p->findUniformLocations();
+        }
+        useShipVariant(shipShaders.get(shipFeatures));
+
+        // Resolve uniform handles; sampler units never change, so they are set once
+        presentProgram.uniform<int>("image").set(0);
+        shipDepthModel = shipDepthProgram.uniform<mat4>("model");
+        taaProgram.uniform<int>("currentColor").set(0);
+        taaProgram.uniform<int>("velocityBuffer").set(1);
+        taaProgram.uniform<int>("historyBuffer").set(2);
+        taaUniforms.renderScale = taaProgram.uniform<glm::vec2>("renderScale");
+        taaUniforms.historyValid = taaProgram.uniform<bool>("historyValid");
     }
     catch (GLSLProgramException& e) {
         cerr << "[ERROR] Shader compilation error: " << e.what() << endl;
@@ -213,11 +450,30 @@ void SceneBasic_Uniform::compile() {
     }
 }
 
+void SceneBasic_Uniform::useShipVariant(GLSLProgram& variant) {
+    if (prog == &variant) return;
+    prog = &variant;
+
+    shipUniforms.model = prog->uniform<mat4>("model");
+    shipUniforms.prevModel = prog->uniform<mat4>("prevModel");
+
+    prog->uniform<int>("albedoMap").set(0);
+    prog->uniform<int>("normalMap").set(1);
+    prog->uniform<int>("metallicMap").set(2);
+    prog->uniform<int>("roughnessMap").set(3);
+    prog->uniform<int>("aoMap").set(4);
+    prog->uniform<int>("environmentMap").set(5);
+}
+
 void SceneBasic_Uniform::handleCollision(const Asteroid& asteroid) {
     // Always set collision detected to true on impact
     collisionDetected = true;
     timeSinceLastCollision = 0.0f;
 
+    // Light up the impact
+    flashPosition = asteroid.position;
+    flashAge = 0.0f;
+
     // Reduce ship health on collision
     shipHealth -= 10;
 
@@ -238,14 +494,33 @@ void SceneBasic_Uniform::handleCollision(const Asteroid& asteroid) {
 }
 
 
+void SceneBasic_Uniform::reportPrepassTiming() {
+    for (int mode = 1; mode >= 0; --mode) {
+        const PrepassTiming& timing = prepassTiming[mode];
+        if (timing.frames == 0) continue;
+        std::cout << "[INFO]   " << (mode ? "with" : "without") << " pre-pass: "
+                  << timing.gpuMilliseconds / timing.frames << " ms GPU at render scale "
+                  << timing.renderScale / timing.frames << " over " << timing.frames << " frames" << std::endl;
+    }
+}
+
 void SceneBasic_Uniform::render() {
-    // First pass: render scene to HDR framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    const RenderPacket& frame = *packet;
+    if (frame.depthPrepass != drawnPrepass) {
+        reportPrepassTiming();
+        drawnPrepass = frame.depthPrepass;
+    }
+
+    frameStream.beginFrame();
+    dynamicResolution.beginFrame();
+    gpuProfiler.setEnabled(frame.gpuProfiling);
+    gpuProfiler.beginFrame();
+    renderWidth = dynamicResolution.scaled(width);
+    renderHeight = dynamicResolution.scaled(height);
 
     // Get ship position and direction for camera positioning
-    glm::vec3 shipPosition = shipController.getPosition();
-    glm::vec3 shipDirection = shipController.getDirection();
+    glm::vec3 shipPosition = frame.shipPosition;
+    glm::vec3 shipDirection = frame.shipDirection;
 
     // Calculate camera position based on model bounds
     Aabb modelBBox = mesh->getBoundingBox();
@@ -253,8 +528,7 @@ void SceneBasic_Uniform::render() {
     modelCenter.y += 2000.0f;
     currentModelCenter = modelCenter;
 
-    float modelRadius = glm::length(modelBBox.max - modelBBox.min) * 0.5f;
-    currentModelRadius = modelRadius;
+    float modelRadius = currentModelRadius;
     float cameraDistance = modelRadius * 2.0f * zoomFactor;
 
     // Calculate camera position - we want it behind the ship
@@ -289,36 +563,177 @@ void SceneBasic_Uniform::render() {
     );
 
     projection = glm::perspective(glm::radians(75.0f), (float)width / height, 0.1f, 50000.0f);
+    glm::mat4 viewProjection = projection * view;
+
+    // Shift the projection by a sub-pixel amount at render resolution, so
+    // successive frames sample different points inside each pixel
+    jitterIndex = jitterIndex % JITTER_SAMPLES + 1;
+    jitter = glm::vec2((halton(jitterIndex, 2) - 0.5f) * 2.0f / renderWidth,
+        (halton(jitterIndex, 3) - 0.5f) * 2.0f / renderHeight);
+    projection[2][0] -= jitter.x;
+    projection[2][1] -= jitter.y;
+
+    updateFrameData();
+    frustum = Frustum::fromMatrix(frameData.viewProjection);
+
+    // The ship is drawn at 100x scale, centred on modelCenter
+    float shipRadius = modelRadius * 100.0f;
+    if (frustum.intersectsSphere(modelCenter, shipRadius)) {
+        GLSLProgram& shipProgram = shipShaders.get(shipFeatures);
+        float shipDistance = glm::distance(cameraPos, modelCenter);
+        renderQueue.submit(RenderQueue::makeKey(RenderQueue::PASS_OPAQUE, shipProgram.getHandle(), MATERIAL_SHIP,
+            shipDistance), [this] { renderModel(); });
+        if (frame.depthPrepass) {
+            renderQueue.submit(RenderQueue::makeKey(RenderQueue::PASS_DEPTH, shipDepthProgram.getHandle(),
+                MATERIAL_SHIP, shipDistance), [this] { renderModelDepth(); });
+        }
+    }
 
-    renderSkybox();
-    renderModel();
-    renderAsteroid();
-
-    // Second pass: tone mapping and gamma correction
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // The ship hides asteroids too; its occluder is a box in the middle
+    // third of its bounds, turned with the ship
+    if (frame.asteroids.cpuCulling) {
+        glm::vec3 half = (modelBBox.max - modelBBox.min) * 0.5f * 100.0f / 3.0f;
+        glm::vec3 forward = glm::normalize(vec3(shipDirection.x, 0.0f, shipDirection.z));
+        glm::vec3 right = glm::cross(forward, vec3(0.0f, 1.0f, 0.0f));
+        asteroidManager.setOccluders({ { modelCenter, { right * half.x, vec3(0.0f, half.y, 0.0f), -forward * half.z } } });
+    }
 
-    hdrProgram.use();
-    hdrProgram.setUniform("hdrBuffer", 0);
-    hdrProgram.setUniform("exposure", exposure);
-    hdrProgram.setUniform("time", prevTime);
+    {
+        GpuProfiler::Scope scope(gpuProfiler, "asteroid cull");
+        asteroidManager.cull(frame.asteroids, frameData.viewProjection, cameraPos, frameStream);
+    }
+    renderQueue.submit(RenderQueue::makeKey(RenderQueue::PASS_OPAQUE, astroidProgram.getHandle(), MATERIAL_ASTEROID, 0.0f),
+        [this] { renderAsteroid(); });
+    if (frame.depthPrepass) {
+        renderQueue.submit(RenderQueue::makeKey(RenderQueue::PASS_DEPTH, asteroidDepthProgram.getHandle(),
+            MATERIAL_ASTEROID, 0.0f), [this] {
+            GpuProfiler::Scope scope(gpuProfiler, "asteroid depth");
+            asteroidManager.renderDepth();
+        });
+    }
 
-    if (collisionDetected && timeSinceLastCollision < 0.3f) {
-        // Red flash intensity based on how recent the collision was
-        float flashIntensity = 0.5f * (0.3f - timeSinceLastCollision) / 0.3f;
-        hdrProgram.setUniform("damageEffect", flashIntensity);
+    // The sky goes last so depth testing rejects every pixel already covered
+    renderQueue.submit(RenderQueue::makeKey(RenderQueue::PASS_SKY, skyboxProgram.getHandle(), MATERIAL_SKYBOX, 0.0f),
+        [this] { renderSkybox(); });
+
+    FrameGraph::TextureDesc historyDesc = { width, height, HDR_FORMAT };
+    FrameGraph::Resource backbuffer = frameGraph.importBackbuffer("backbuffer", width, height);
+    FrameGraph::Resource history = frameGraph.importTexture("history", historyTextures[historyIndex], historyDesc);
+    FrameGraph::Resource prevHistory = frameGraph.importTexture("previous history",
+        historyTextures[1 - historyIndex], historyDesc);
+    FrameGraph::Resource hdrColor = -1;
+    FrameGraph::Resource velocity = -1;
+
+    // First pass: render scene to HDR framebuffer, with screen-space motion
+    frameGraph.addPass("scene", [&](FrameGraph::Builder& pass) {
+        hdrColor = pass.write(pass.create("hdr color", { width, height, HDR_FORMAT }));
+        velocity = pass.write(pass.create("velocity", { width, height, GL_RG16F }));
+        pass.write(pass.create("scene depth", { width, height, DEPTH_FORMAT }));
+    }, [this](const FrameGraph&) {
+        const GLfloat still[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        glClearBufferfv(GL_COLOR, 1, still);
+        glViewport(0, 0, renderWidth, renderHeight);
+
+        // Depth-only draws leave the colour targets alone
+        renderQueue.execute([](RenderQueue::Pass pass) {
+            GLboolean color = pass == RenderQueue::PASS_DEPTH ? GL_FALSE : GL_TRUE;
+            glColorMask(color, color, color, color);
+        });
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    });
+
+    // Second pass: upsample to full resolution against the reprojected history
+    frameGraph.addPass("taa", [&](FrameGraph::Builder& pass) {
+        pass.read(hdrColor);
+        pass.read(velocity);
+        pass.read(prevHistory);
+        pass.write(history);
+    }, [this, hdrColor, velocity, prevHistory](const FrameGraph& graph) {
+        GpuProfiler::Scope scope(gpuProfiler, "taa");
+        glViewport(0, 0, width, height);
+
+        taaProgram.use();
+        // The pooled targets may be larger than the window
+        const FrameGraph::TextureDesc& storage = graph.storage(hdrColor);
+        taaUniforms.renderScale.set(glm::vec2((float)renderWidth / storage.width, (float)renderHeight / storage.height));
+        taaUniforms.historyValid.set(historyValid);
+
+        GLStateCache::bindTexture(0, graph.texture(hdrColor));
+        GLStateCache::bindTexture(1, graph.texture(velocity));
+        GLStateCache::bindTexture(2, graph.texture(prevHistory));
+
+        glDisable(GL_DEPTH_TEST);
+        renderQuad();
+        glEnable(GL_DEPTH_TEST);
+    });
+
+    // Third pass: tone mapping, grain and exposure metering in compute
+    FrameGraph::Resource ldrColor = -1;
+    frameGraph.addPass("post", [&](FrameGraph::Builder& pass) {
+        pass.read(history);
+        ldrColor = pass.write(pass.create("ldr color", { width, height, GL_RGBA8 }), FrameGraph::IMAGE);
+    }, [this, history, ldrColor](const FrameGraph& graph) {
+        GpuProfiler::Scope scope(gpuProfiler, "post");
+        postProcessing.apply(graph.texture(history), graph.texture(ldrColor), width, height, packet->damageEffect,
+            packet->deltaTime);
+    });
+
+    // Fourth pass: copy to the window, which compute cannot write
+    frameGraph.addPass("present", [&](FrameGraph::Builder& pass) {
+        pass.read(ldrColor);
+        pass.write(backbuffer);
+    }, [this, ldrColor](const FrameGraph& graph) {
+        GpuProfiler::Scope scope(gpuProfiler, "present");
+        presentProgram.use();
+        GLStateCache::bindTexture(0, graph.texture(ldrColor));
+
+        glDisable(GL_DEPTH_TEST);
+        renderQuad();
+        glEnable(GL_DEPTH_TEST);
+    });
+
+    frameGraph.execute();
+
+    // Read back the finished frame if it is being captured
+    if (frame.recording != drawnRecording) {
+        if (frame.recording) frameCapture.startRecording(width, height);
+        else frameCapture.stopRecording();
+        drawnRecording = frame.recording;
     }
-    else {
-        hdrProgram.setUniform("damageEffect", 0.0f);
+    if (frame.screenshot) frameCapture.requestScreenshot();
+    {
+        GpuProfiler::Scope scope(gpuProfiler, "capture");
+        frameCapture.capture(width, height);
     }
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, hdrColorBuffer);
+    gpuProfiler.endFrame();
+    dynamicResolution.endFrame();
+    frameStream.endFrame();
 
-    // Render quad
-    glDisable(GL_DEPTH_TEST);
-    renderQuad();
-    glEnable(GL_DEPTH_TEST);
+    if (dynamicResolution.gpuMilliseconds() > 0.0f) {
+        PrepassTiming& timing = prepassTiming[frame.depthPrepass];
+        timing.gpuMilliseconds += dynamicResolution.gpuMilliseconds();
+        timing.renderScale += dynamicResolution.scale();
+        ++timing.frames;
+    }
+
+    // This frame's output is next frame's history
+    prevViewProjection = viewProjection;
+    historyIndex = 1 - historyIndex;
+    historyValid = true;
+
+    // Report CPU culling once a second while it is in use
+    cullStatsTimer = frame.asteroids.cpuCulling ? cullStatsTimer + frame.deltaTime : 0.0f;
+    if (cullStatsTimer >= 1.0f) {
+        const FrustumCuller::Stats& stats = asteroidManager.getCullStats();
+        const OcclusionCuller::Stats& occlusion = asteroidManager.getOcclusionStats();
+        std::cout << "[INFO] CPU culling (" << stats.path << "): " << stats.visible << "/" << stats.total
+                  << " asteroids visible, " << stats.milliseconds << " ms; occlusion (" << occlusion.path << "): "
+                  << asteroidManager.getOccludedDraws() << " draws saved, " << occlusion.occluders << " occluders, "
+                  << occlusion.milliseconds << " ms on the worker" << std::endl;
+        cullStatsTimer = 0.0f;
+    }
 }
 
 void SceneBasic_Uniform::printGameOver() {
@@ -335,100 +750,168 @@ void SceneBasic_Uniform::printGameOver() {
 
 
 void SceneBasic_Uniform::renderAsteroid() {
-    // Calculate the light position
+    // Use the asteroid manager to render the visible asteroids; camera and
+    // lights come from the FrameData block and the light clusters
+    GpuProfiler::Scope scope(gpuProfiler, "asteroids");
+    asteroidManager.render(packet->depthPrepass);
+}
+
+void SceneBasic_Uniform::gatherLights() {
+    lights.clear();
+
+    // Calculate animated light position that dances around the top of the ship
     float baseOrbitRadius = currentModelRadius * 4.0f;
-    float lightOrbitRadius = baseOrbitRadius + lightRadiusOffset;
+    float lightOrbitRadius = baseOrbitRadius + packet->lightRadiusOffset;
+
+    float lightX = currentModelCenter.x + lightOrbitRadius * cos(glm::radians(packet->lightOrbitAngle));
+    float lightZ = currentModelCenter.z + lightOrbitRadius * sin(glm::radians(packet->lightOrbitAngle));
+    float lightY = currentModelCenter.y + currentModelRadius * 10.0f + packet->lightVerticalOffset;
+    lights.push_back({ vec3(lightX, lightY, lightZ), 30000.0f, vec3(1.0f), lightIntensity, lightRadius, {} });
+
+    // Engine glow at the back of the ship and blinking navigation lights on
+    // either side; the ship is drawn at 100x scale
+    glm::vec3 direction = packet->shipDirection;
+    glm::vec3 forward = glm::normalize(vec3(direction.x, 0.0f, direction.z));
+    glm::vec3 right = glm::cross(forward, vec3(0.0f, 1.0f, 0.0f));
+    float shipSize = currentModelRadius * 100.0f;
+    float flicker = 3.0f + 0.5f * sin(packet->time * 30.0f);
+    lights.push_back({ currentModelCenter - forward * shipSize * 0.8f, shipSize * 3.0f,
+        vec3(0.3f, 0.6f, 1.0f), flicker, shipSize * 0.3f, {} });
+
+    float navIntensity = fmod(packet->time, 1.5f) < 0.2f ? 2.0f : 0.0f;
+    lights.push_back({ currentModelCenter - right * shipSize * 0.7f, shipSize * 1.5f,
+        vec3(1.0f, 0.1f, 0.1f), navIntensity, shipSize * 0.1f, {} });
+    lights.push_back({ currentModelCenter + right * shipSize * 0.7f, shipSize * 1.5f,
+        vec3(0.1f, 1.0f, 0.1f), navIntensity, shipSize * 0.1f, {} });
+
+    // Red-orange flash fading out where the ship was hit
+    if (packet->flashAge < FLASH_DURATION) {
+        float fade = 1.0f - packet->flashAge / FLASH_DURATION;
+        lights.push_back({ packet->flashPosition, 6000.0f, vec3(1.0f, 0.5f, 0.2f), 60.0f * fade * fade, 300.0f, {} });
+    }
 
-    float lightX = currentModelCenter.x + lightOrbitRadius * cos(glm::radians(lightOrbitAngle));
-    float lightZ = currentModelCenter.z + lightOrbitRadius * sin(glm::radians(lightOrbitAngle));
-    float lightY = currentModelCenter.y + currentModelRadius * 10.0f + lightVerticalOffset;
-    vec3 lightPosition = vec3(lightX, lightY, lightZ);
+    // Pulsing navigation beacons on every other asteroid
+    Aabb rock = asteroidManager.getBaseMeshBoundingBox();
+    float rockRadius = glm::length(rock.max - rock.min) * 0.5f;
+    static const std::vector<Asteroid> none;
+    const std::vector<Asteroid>& asteroids = packet->asteroids.asteroids ? *packet->asteroids.asteroids : none;
+    for (size_t i = 0; i < asteroids.size() && lights.size() < ClusteredLighting::MAX_LIGHTS; i += 2) {
+        const Asteroid& asteroid = asteroids[i];
+        float pulse = 0.5f + 0.5f * sin(packet->time * 2.0f + (float)i);
+        lights.push_back({ asteroid.position + vec3(0.0f, rockRadius * asteroid.scale.y * 1.1f, 0.0f), 2500.0f,
+            vec3(1.0f, 0.6f, 0.2f), 30.0f * pulse, 200.0f, {} });
+    }
+}
 
-    // Use the asteroid manager to render all asteroids
-    asteroidManager.render(view, projection, lightPosition, currentCameraPos);
+void SceneBasic_Uniform::updateFrameData() {
+    gatherLights();
+
+    frameData.view = view;
+    frameData.projection = projection;
+    frameData.viewProjection = projection * view;
+    frameData.prevViewProjection = prevViewProjection;
+    frameData.jitter = jitter;
+    frameData.viewPos = currentCameraPos;
+    frameData.time = packet->time;
+    clusteredLighting.setupFrame(frameData, renderWidth, renderHeight, CLUSTER_NEAR_DEPTH, CLUSTER_FAR_DEPTH,
+        lights.size());
+
+    // One upload per frame, shared by every program
+    frameStream.bindUniform(FRAME_DATA_BINDING, frameData);
+
+    // Sort the lights into clusters before anything is shaded
+    GpuProfiler::Scope scope(gpuProfiler, "light cull");
+    clusteredLighting.cull(lights, projection, frameStream);
 }
 
 void SceneBasic_Uniform::resize(int w, int h) {
+    bool changed = w != width || h != height;
     width = w;
     height = h;
     glViewport(0, 0, w, h);
 
-    // Resize HDR framebuffer
-    glBindTexture(GL_TEXTURE_2D, hdrColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, w, h, 0, GL_RGBA, GL_FLOAT, NULL);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, w, h);
+    // The frame graph picks up the new size for its targets next frame,
+    // reusing them if it stays in their size class; the history is owned
+    // here and starts over
+    if (changed) createHistory();
+}
+
+void SceneBasic_Uniform::createHistory() {
+    for (GLuint& texture : historyTextures) {
+        if (texture != 0) {
+            frameGraph.forgetTexture(texture);
+            glDeleteTextures(1, &texture);
+        }
+        glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+        glTextureStorage2D(texture, 1, HDR_FORMAT, width, height);
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    GLStateCache::invalidate();
+    historyValid = false;
 }
 
 void SceneBasic_Uniform::setMatrices() {
-    prog.setUniform("model", model);
-    prog.setUniform("view", view);
-    prog.setUniform("projection", projection);
+    shipUniforms.model.set(model);
+    shipUniforms.prevModel.set(prevModel);
 }
 
 void SceneBasic_Uniform::renderSkybox() {
+    GpuProfiler::Scope scope(gpuProfiler, "skybox");
     glDepthMask(GL_FALSE);
     skyboxProgram.use();
-    mat4 skyboxView = mat4(mat3(view));
-    skyboxProgram.setUniform("view", skyboxView);
-    skyboxProgram.setUniform("projection", projection);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTex);
+    GLStateCache::bindTexture(0, skyboxTex);
     sky.render();
     glDepthMask(GL_TRUE);
 }
 
 void SceneBasic_Uniform::renderModel() {
-    prog.use();
-
-    // Bind PBR textures
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, albedoMap);
-    prog.setUniform("albedoMap", 0);
-
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, normalMap);
-    prog.setUniform("normalMap", 1);
-
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, metallicMap);
-    prog.setUniform("metallicMap", 2);
-
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, roughnessMap);
-    prog.setUniform("roughnessMap", 3);
-
-    glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_2D, aoMap);
-    prog.setUniform("aoMap", 4);
-
-    glActiveTexture(GL_TEXTURE5);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTex);
-    prog.setUniform("environmentMap", 5);
-
-    // Calculate animated light position that dances around the top of the ship
-    float baseOrbitRadius = currentModelRadius * 4.0f;
-    float lightOrbitRadius = baseOrbitRadius + lightRadiusOffset;
-
-    float lightX = currentModelCenter.x + lightOrbitRadius * cos(glm::radians(lightOrbitAngle));
-    float lightZ = currentModelCenter.z + lightOrbitRadius * sin(glm::radians(lightOrbitAngle));
-    float lightY = currentModelCenter.y + currentModelRadius * 10.0f + lightVerticalOffset;
+    GpuProfiler::Scope scope(gpuProfiler, "ship");
+    useShipVariant(shipShaders.get(shipFeatures));
+    prog->use();
+
+    // Bind PBR textures; the sampler units were set when the variant was resolved
+    GLStateCache::bindTexture(0, albedoMap);
+    GLStateCache::bindTexture(1, normalMap);
+    GLStateCache::bindTexture(2, metallicMap);
+    GLStateCache::bindTexture(3, roughnessMap);
+    GLStateCache::bindTexture(4, aoMap);
+    GLStateCache::bindTexture(5, skyboxTex);
+
+    model = shipModelMatrix();
+    setMatrices();
 
-    vec3 lightPosition = vec3(lightX, lightY, lightZ);
+    // With the pre-pass, depth is already written and only the visible
+    // surface passes
+    if (packet->depthPrepass) {
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
+    mesh->render();
+    prevModel = model;
+    if (packet->depthPrepass) {
+        glDepthFunc(GL_LEQUAL);
+        glDepthMask(GL_TRUE);
+    }
+}
 
-    // Set shader uniforms for light and view positions
-    prog.setUniform("lightPos", lightPosition);
-    prog.setUniform("lightRadius", lightRadius);
-    prog.setUniform("viewPos", currentCameraPos);
-    prog.setUniform("lightIntensity", lightIntensity);
+void SceneBasic_Uniform::renderModelDepth() {
+    GpuProfiler::Scope scope(gpuProfiler, "ship depth");
+    shipDepthProgram.use();
+    shipDepthModel.set(shipModelMatrix());
+    mesh->render();
+}
 
+glm::mat4 SceneBasic_Uniform::shipModelMatrix() const {
     // Get ship position and direction
-    glm::vec3 shipPosition = shipController.getPosition();
-    glm::vec3 shipDirection = shipController.getDirection();
+    glm::vec3 shipPosition = packet->shipPosition;
+    glm::vec3 shipDirection = packet->shipDirection;
 
     // Set model transformations
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, shipPosition);
+    glm::mat4 transform = glm::mat4(1.0f);
+    transform = glm::translate(transform, shipPosition);
 
     // Calculate rotation based on ship direction
     float defaultAngle = atan2(0.0f, -1.0f);
@@ -436,15 +919,13 @@ void SceneBasic_Uniform::renderModel() {
     float rotationAngle = currentAngle - defaultAngle;
 
     // Apply the rotation around Y axis
-    model = glm::rotate(model, rotationAngle, glm::vec3(0.0f, 1.0f, 0.0f));
+    transform = glm::rotate(transform, rotationAngle, glm::vec3(0.0f, 1.0f, 0.0f));
 
     // Continue with the rest of the transformations
-    model = glm::scale(model, vec3(100.0f));
-    model = glm::translate(model, vec3(0.0f, 20.0f, 0.0f));
-    model = glm::rotate(model, glm::radians(0.0f), vec3(0.0f, 1.0f, 0.0f));
-
-    setMatrices();
-    mesh->render();
+    transform = glm::scale(transform, vec3(100.0f));
+    transform = glm::translate(transform, vec3(0.0f, 20.0f, 0.0f));
+    transform = glm::rotate(transform, glm::radians(0.0f), vec3(0.0f, 1.0f, 0.0f));
+    return transform;
 }
 
 void SceneBasic_Uniform::renderQuad() {
@@ -461,7 +942,7 @@ void SceneBasic_Uniform::renderQuad() {
         // setup plane VAO
         glGenVertexArrays(1, &quadVAO);
         glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
+        GLStateCache::bindVertexArray(quadVAO);
         glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
@@ -469,7 +950,6 @@ void SceneBasic_Uniform::renderQuad() {
         glEnableVertexAttribArray(1);
         glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
     }
-    glBindVertexArray(quadVAO);
+    GLStateCache::bindVertexArray(quadVAO);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
 }
@@ -5,12 +5,24 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "helper/glslprogram.h"
+#include "helper/shadervariantcache.h"
+#include "helper/streambuffer.h"
+#include "helper/renderqueue.h"
+#include "helper/framegraph.h"
+#include "helper/dynamicresolution.h"
+#include "helper/renderthread.h"
+#include "helper/framecapture.h"
+#include "helper/gpuprofiler.h"
+#include "framedata.h"
+#include "renderpacket.h"
 #include "skybox.h"
 #include "objmesh.h"
 #include "texture.h"
 #include "ShipController.h"
 #include "Asteroid.h"
 #include "CollisionDetection.h"
+#include "ClusteredLighting.h"
+#include "PostProcessing.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -19,10 +31,21 @@ class SceneBasic_Uniform : public Scene
 {
 private:
     // ======== Shader Programs ========
-    GLSLProgram prog;           // Ship shader
+    ShaderVariantCache shipShaders; // Ship shader, specialised per feature set
+    GLSLProgram* prog;          // Ship variant used this frame
+    GLSLProgram shipDepthProgram;     // Depth-only pre-pass for the ship
+    GLSLProgram asteroidDepthProgram; // Depth-only pre-pass for nearby asteroids
     GLSLProgram skyboxProgram;  // Skybox shader
     GLSLProgram astroidProgram; // Asteroid shader
-    GLSLProgram hdrProgram;     // HDR post-processing
+    GLSLProgram asteroidFadeProgram; // Asteroid shader for the level that fades to impostors
+    GLSLProgram impostorProgram;     // Distant asteroids as impostor quads
+    GLSLProgram impostorBakeProgram; // Renders the impostor atlas at startup
+    GLSLProgram asteroidCullProgram; // Asteroid culling compute shader
+    GLSLProgram lightCullProgram; // Light cluster assignment compute shader
+    GLSLProgram taaProgram;     // Temporal upsampling
+    GLSLProgram postProgram;    // Compute post-processing and metering
+    GLSLProgram exposureProgram; // Auto-exposure from the luminance histogram
+    GLSLProgram presentProgram; // Copies the result to the window
 
     // ======== Scene Meshes ========
     SkyBox sky;
@@ -47,6 +70,10 @@ private:
     // ======== Transform Matrices ========
     glm::mat4 model, view, projection;
 
+    // Last frame's transforms, for motion vectors
+    glm::mat4 prevViewProjection; // Without jitter
+    glm::mat4 prevModel;
+
     // ======== Camera Properties ========
     float prevTime;        // Previous frame time
     float zoomFactor;      // Camera distance multiplier
@@ -64,11 +91,102 @@ private:
     float lightRadius;          // Size of the light source
     float lightIntensity;       // Intensity of the light source
 
+    // Every light in the scene, rebuilt each frame and sorted into clusters
+    ClusteredLighting clusteredLighting;
+    std::vector<PointLight> lights;
+    glm::vec3 flashPosition;    // Where the last collision happened
+    float flashAge;             // Seconds since then
+
+    // ======== Shader Features ========
+    enum ShipShaderFeature : uint32_t {
+        SHIP_CHROMATIC_ABERRATION = 1 << 0,
+        SHIP_ENVIRONMENT_REFLECTIONS = 1 << 1,
+        SHIP_NORMAL_MAPPING = 1 << 2
+    };
+    uint32_t shipFeatures;      // Feature bits of the ship variant to draw with
+
+    // ======== Visibility ========
+    Frustum frustum;            // This frame's view frustum
+    bool cullKeyDown;           // C held last frame, to toggle once per press
+    float cullStatsTimer;       // Time since culling stats were last printed; render thread
+
+    // ======== Draw Ordering ========
+    // Scene draws are queued and issued sorted by program, material and depth
+    enum Material : uint32_t {
+        MATERIAL_SHIP = 1,
+        MATERIAL_ASTEROID = 2,
+        MATERIAL_SKYBOX = 3
+    };
+    RenderQueue renderQueue;
+
+    // Optional depth pre-pass: the ship and nearby asteroids lay down depth
+    // first, then are shaded with GL_EQUAL so each pixel is shaded once
+    bool depthPrepass;          // Game-side setting, passed on in the packet
+    bool prepassKeyDown;        // P held last frame
+    bool drawnPrepass;          // Mode of the last frame drawn; render thread
+    struct PrepassTiming {
+        double gpuMilliseconds; // Sums over the frames drawn in one mode
+        double renderScale;
+        int frames;
+    } prepassTiming[2];         // Indexed by depthPrepass
+    void reportPrepassTiming();
+
+    // ======== Render Packets ========
+    // Written by the game thread after update(), read by render() on the
+    // render thread; render() touches no other simulation state
+    RenderPacket packets[RenderThread::SLOTS];
+    const RenderPacket* packet; // The one being drawn
+
+    // ======== Per-Frame Data ========
+    // Camera, light and time, written once per frame for every shader
+    FrameData frameData;
+    StreamBuffer frameStream;   // Everything uploaded per frame is written here
+
+    // ======== Uniform Handles ========
+    // Resolved once per program, then set without binding or name lookups
+    struct ShipUniforms {
+        UniformHandle<glm::mat4> model, prevModel;
+    } shipUniforms;
+    UniformHandle<glm::mat4> shipDepthModel;
+    struct TaaUniforms {
+        UniformHandle<glm::vec2> renderScale;
+        UniformHandle<bool> historyValid;
+    } taaUniforms;
+
     // ======== HDR Rendering ========
-    GLuint hdrFBO;
-    GLuint hdrColorBuffer;
-    GLuint rboDepth;
-    float exposure = 0.15f;
+    // Scene, upsampling and post-processing passes; targets are allocated by the graph
+    FrameGraph frameGraph;
+    PostProcessing postProcessing; // Tone mapping with GPU auto-exposure
+
+    // The scene renders into the top-left renderWidth x renderHeight of
+    // full-size targets; the TAA pass upsamples it to the window
+    DynamicResolution dynamicResolution;
+    int renderWidth;
+    int renderHeight;
+
+    // ======== Temporal Anti-Aliasing ========
+    // Full-resolution output of the last two frames, read and written in turn
+    GLuint historyTextures[2];
+    int historyIndex;           // The one written this frame
+    bool historyValid;          // False until a frame has been resolved at this size
+    unsigned jitterIndex;       // Position in the jitter sequence
+    glm::vec2 jitter;           // This frame's offset, in NDC
+
+    // ======== Frame Capture ========
+    // F12 saves a screenshot, F9 starts and stops recording; read back
+    // without stalling and written out on a background thread
+    FrameCapture frameCapture;
+    bool screenshotRequested;   // Set by F12 until the next packet takes it
+    bool recording;             // Game-side setting, passed on in the packet
+    bool screenshotKeyDown;
+    bool recordKeyDown;
+    bool drawnRecording;        // Recording state the render thread last acted on
+
+    // ======== GPU Profiling ========
+    // G toggles per-pass GPU timings and pipeline statistics
+    GpuProfiler gpuProfiler;
+    bool gpuProfiling;          // Game-side setting, passed on in the packet
+    bool profileKeyDown;
 
     // ======== Collision Detection ========
     CollisionDetection collisionSystem;
@@ -80,11 +198,17 @@ private:
 
     // ======== Internal Render Methods ========
     void compile();             // Compile all shaders
+    void useShipVariant(GLSLProgram& variant); // Switch ship programs and resolve its uniforms
     void setMatrices();         // Set uniform matrices for rendering
+    void gatherLights();        // Collect this frame's lights
+    void updateFrameData();     // Fill and upload the per-frame uniform block and lights
     void renderSkybox();        // Render skybox
     void renderModel();         // Render ship model
+    void renderModelDepth();    // Render ship depth only
+    glm::mat4 shipModelMatrix() const; // Ship transform for this frame
     void renderAsteroid();      // Render asteroid field
     void renderQuad();          // Render screen quad for post-processing
+    void createHistory();       // (Re)create the TAA history at window size
 
     // ======== Window Reference ========
     GLFWwindow* window = nullptr; // Reference to the GLFW window
@@ -100,6 +224,8 @@ public:
     // ======== Scene Interface Implementation ========
     void initScene() override;
     void update(float t) override;
+    void writePacket(int slot) override;
+    void readPacket(int slot) override;
     void render() override;
     void resize(int w, int h) override;
     void printGameOver();
@@ -1,36 +1,74 @@
 #version 460
 
-// Vertex attributes
-layout (location = 0) in vec3 VertexPosition;
-layout (location = 1) in vec3 VertexColor;
-layout (location = 2) in vec3 VertexNormal;
-layout (location = 3) in vec2 VertexTexCoords;
-layout (location = 4) in vec3 VertexTangent;
-layout (location = 5) in vec3 VertexBitangent;
+#include "common/vertex_inputs.glsl"
+#include "common/frame_data.glsl"
 
+// The depth pre-pass builds this shader with DEPTH_ONLY; the shading pass
+// tests GL_EQUAL against its depth, so both must produce the same position
+invariant gl_Position;
+
+#ifdef DEPTH_ONLY
+vec3 FragPos;
+#else
 // Output to fragment shader
 out vec3 FragPos;      // World-space position
 out vec2 TexCoords;    // UV texture coordinates
 out mat3 TBN;          // Tangent-Bitangent-Normal matrix
+out vec4 CurrentClip;  // This and last frame's clip positions, for motion vectors
+out vec4 PreviousClip;
+#endif
+#ifdef IMPOSTOR_FADE
+flat out float Fade;   // Share of this asteroid still drawn as mesh
+#endif
+
+#include "common/asteroid_instance.glsl"
+#ifdef IMPOSTOR_FADE
+#include "common/impostor.glsl"
+#endif
+
+// Index into instances[], one per drawn instance, read from the culling
+// pass's visible list
+layout (location = 6) in uint InstanceIndex;
 
-// Transformation matrices
-uniform mat4 model;         // Model matrix
-uniform mat4 view;          // View matrix
-uniform mat4 projection;    // Projection matrix
-uniform mat3 normalMatrix;  // Inverse transpose of the model matrix
+uniform float spinTime;     // Seconds since the instances were written
+uniform float prevSpinTime; // spinTime last frame
 
 void main()
 {
+    AsteroidInstance asteroid = instances[InstanceIndex];
+
+    // Same order as the CPU transform: translate * rotX * rotY * rotZ * scale
+    mat3 rotation = asteroidRotation(asteroid, spinTime);
+
     // Transform vertex position to world space
-    FragPos = vec3(model * vec4(VertexPosition, 1.0));
+    FragPos = asteroid.position + rotation * (asteroid.scale * VertexPosition);
+
+#ifndef DEPTH_ONLY
     TexCoords = VertexTexCoords;
 
+    // Inverse transpose of rotation * scale
+    mat3 normalMatrix = rotation * mat3(1.0 / asteroid.scale.x, 0.0, 0.0,
+                                        0.0, 1.0 / asteroid.scale.y, 0.0,
+                                        0.0, 0.0, 1.0 / asteroid.scale.z);
+
     // Construct TBN matrix for normal mapping
     vec3 T = normalize(normalMatrix * VertexTangent);
     vec3 B = normalize(normalMatrix * VertexBitangent);
     vec3 N = normalize(normalMatrix * VertexNormal);
     TBN = mat3(T, B, N);
+#endif
 
     // Transform to clip space
-    gl_Position = projection * view * vec4(FragPos, 1.0);
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
+
+#ifndef DEPTH_ONLY
+    CurrentClip = gl_Position;
+
+    // Where the same vertex was last frame, spun back by the elapsed time
+    mat3 prevRotation = asteroidRotation(asteroid, prevSpinTime);
+    PreviousClip = prevViewProjection * vec4(asteroid.position + prevRotation * (asteroid.scale * VertexPosition), 1.0);
+#endif
+#ifdef IMPOSTOR_FADE
+    Fade = impostorFade(asteroid.position, asteroid.scale);
+#endif
 }
@@ -1,31 +1,35 @@
 #version 460
 
-// Vertex attributes
-layout (location = 0) in vec3 VertexPosition;
-layout (location = 1) in vec3 VertexColor;
-layout (location = 2) in vec3 VertexNormal;
-layout (location = 3) in vec2 VertexTexCoords;
-layout (location = 4) in vec3 VertexTangent;
-layout (location = 5) in vec3 VertexBitangent;
+#include "common/vertex_inputs.glsl"
+#include "common/frame_data.glsl"
 
+// The depth pre-pass builds this shader with DEPTH_ONLY; the shading pass
+// tests GL_EQUAL against its depth, so both must produce the same position
+invariant gl_Position;
+
+#ifdef DEPTH_ONLY
+vec3 FragPos;
+#else
 // Output to fragment shader
 out vec3 Color;
 out vec3 Normal;
 out vec3 FragPos;
 out vec2 TexCoords;
 out mat3 TBN;         // Tangent-Bitangent-Normal matrix
+out vec4 CurrentClip; // This and last frame's clip positions, for motion vectors
+out vec4 PreviousClip;
+#endif
 
-// Transformation matrices
+// Model transformation; view and projection come from FrameData
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform vec3 lightPos;
-uniform vec3 viewPos;
+uniform mat4 prevModel;   // Last frame's model matrix
 
 void main()
 {
     // Transform position to world space
     FragPos = vec3(model * vec4(VertexPosition, 1.0));
+
+#ifndef DEPTH_ONLY
     TexCoords = VertexTexCoords;
     
     // Construct TBN matrix for normal mapping
@@ -33,7 +37,13 @@ void main()
     vec3 B = normalize(mat3(model) * VertexBitangent);
     vec3 N = normalize(mat3(model) * VertexNormal);
     TBN = mat3(T, B, N);
+#endif
     
     // Final position in clip space
-    gl_Position = projection * view * model * vec4(VertexPosition, 1.0);
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
+
+#ifndef DEPTH_ONLY
+    CurrentClip = gl_Position;
+    PreviousClip = prevViewProjection * prevModel * vec4(VertexPosition, 1.0);
+#endif
 }
@@ -0,0 +1,37 @@
+// One entry per asteroid; must match AsteroidInstance in Asteroid.h
+struct AsteroidInstance {
+    vec3 position;
+    float rotationSpeed;  // Radians per second about Y
+    vec3 rotation;        // Euler angles when the buffer was written
+    vec3 scale;
+};
+
+layout (std430, binding = 1) readonly buffer AsteroidInstances {
+    AsteroidInstance instances[];
+};
+
+mat3 rotationX(float a)
+{
+    float c = cos(a), s = sin(a);
+    return mat3(1.0, 0.0, 0.0,  0.0, c, s,  0.0, -s, c);
+}
+
+mat3 rotationY(float a)
+{
+    float c = cos(a), s = sin(a);
+    return mat3(c, 0.0, -s,  0.0, 1.0, 0.0,  s, 0.0, c);
+}
+
+mat3 rotationZ(float a)
+{
+    float c = cos(a), s = sin(a);
+    return mat3(c, s, 0.0,  -s, c, 0.0,  0.0, 0.0, 1.0);
+}
+
+// Rotation after spinning for spinTime seconds, in the same order as the
+// CPU transform: rotX * rotY * rotZ
+mat3 asteroidRotation(AsteroidInstance asteroid, float spinTime)
+{
+    vec3 angles = asteroid.rotation + vec3(0.0, asteroid.rotationSpeed * spinTime, 0.0);
+    return rotationX(angles.x) * rotationY(angles.y) * rotationZ(angles.z);
+}
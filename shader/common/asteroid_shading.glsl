@@ -0,0 +1,44 @@
+// Asteroid material, shared by the mesh and its impostors so the two
+// match where they cross-fade
+#include "lighting.glsl"
+
+// The asteroid textures are wrapped around a sphere
+vec2 sphericalUV(vec3 position)
+{
+    vec3 nrmPos = normalize(position);
+    float u = 0.5 + atan(nrmPos.z, nrmPos.x) / (2.0 * PI);
+    float v = 0.5 - asin(nrmPos.y) / PI;
+    return vec2(u, v);
+}
+
+// Ambient plus simple diffuse lighting from the lights in this fragment's
+// cluster, gamma corrected
+vec3 shadeAsteroid(vec3 albedo, vec3 N, vec3 position)
+{
+    // Basic ambient component
+    vec3 ambient = albedo * 0.3;
+
+    vec3 diffuse = vec3(0.0);
+    uint cluster = clusterIndex(position);
+    uint lightTotal = clusterLightCounts[cluster];
+    for (uint i = 0; i < lightTotal; ++i) {
+        PointLight light = lights[clusterLightIndices[cluster * MAX_CLUSTER_LIGHTS + i]];
+
+        vec3 L = normalize(light.position - position);
+        float distance = length(light.position - position);
+
+        // Apply distance attenuation to light
+        // Adjust the constants to control falloff rate
+        float attenuation = 1.0 / (1.0 + 0.0002 * distance + 0.00000005 * distance * distance);
+        attenuation *= rangeWindow(distance, light.range);
+
+        float diff = max(dot(N, L), 0.0);
+        diffuse += diff * albedo * light.color * light.intensity * LIGHT_INTENSITY_SCALE * attenuation;
+    }
+
+    // Combine lighting components
+    vec3 result = ambient + diffuse;
+
+    // Basic gamma correction
+    return pow(result, vec3(1.0/2.2));
+}
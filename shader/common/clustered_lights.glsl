@@ -0,0 +1,32 @@
+// Point lights sorted into a froxel grid: the view is split into
+// CLUSTER_GRID_X x CLUSTER_GRID_Y screen tiles and CLUSTER_GRID_Z slices
+// spaced logarithmically in depth.  light_cull.comp writes, for every
+// cluster, the lights that reach it; a fragment only loops over the lights
+// in its own cluster.  The grid sizes are defined by the application.
+// The layouts must match ClusteredLighting.h.
+#include "frame_data.glsl"
+
+struct PointLight {
+    vec3 position;        // World space
+    float range;          // No light reaches past this distance
+    vec3 color;
+    float intensity;
+    float radius;         // Softens the inverse square falloff near the light
+    float padding0, padding1, padding2;
+};
+
+#ifndef CLUSTER_ACCESS
+#define CLUSTER_ACCESS readonly
+#endif
+
+layout (std430, binding = 4) readonly buffer Lights {
+    PointLight lights[];
+};
+
+layout (std430, binding = 5) CLUSTER_ACCESS buffer ClusterLightCounts {
+    uint clusterLightCounts[];
+};
+
+layout (std430, binding = 6) CLUSTER_ACCESS buffer ClusterLightIndices {
+    uint clusterLightIndices[];   // MAX_CLUSTER_LIGHTS slots per cluster
+};
@@ -0,0 +1,29 @@
+// Luminance histogram and adapted exposure.  postprocess.comp adds each
+// frame's pixels to the histogram; exposure.comp turns it into the next
+// frame's exposure and clears it.  Nothing here is read by the CPU.
+//
+// Bin 0 counts pixels too dark to meter (empty space); bins 1 to
+// HISTOGRAM_BINS - 1 cover log2 luminance from MIN_LOG_LUMINANCE over
+// LOG_LUMINANCE_RANGE stops.
+
+layout (std430, binding = 7) buffer Exposure {
+    uint histogram[HISTOGRAM_BINS];
+    float adaptedLuminance;     // Smoothed average scene luminance
+    float exposure;             // Used by the next post-processing pass
+};
+
+const vec3 LUMINANCE_WEIGHTS = vec3(0.2126, 0.7152, 0.0722);
+
+uint luminanceBin(float luminance)
+{
+    if (luminance < exp2(MIN_LOG_LUMINANCE)) return 0u;
+    float position = clamp((log2(luminance) - MIN_LOG_LUMINANCE) / LOG_LUMINANCE_RANGE, 0.0, 1.0);
+    return uint(position * float(HISTOGRAM_BINS - 2)) + 1u;
+}
+
+// Luminance at the centre of a (fractional) bin
+float binLuminance(float bin)
+{
+    float position = (bin - 0.5) / float(HISTOGRAM_BINS - 2);
+    return exp2(position * LOG_LUMINANCE_RANGE + MIN_LOG_LUMINANCE);
+}
@@ -0,0 +1,15 @@
+// Per-frame scene data, written once per frame by the application.
+// The layout must match struct FrameData in framedata.h.
+layout (std140, binding = 0) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;  // Includes this frame's jitter
+    mat4 prevViewProjection; // Last frame's, without jitter
+    vec3 viewPos;         // Camera position in world space
+    float time;           // Seconds since start
+    vec2 clusterScale;    // Light cluster tiles per pixel
+    float clusterDepthScale; // Slice = log(view depth) * scale + bias
+    float clusterDepthBias;
+    uint lightCount;      // Lights in the light buffer this frame
+    vec2 jitter;          // Sub-pixel offset in NDC applied to projection
+};
@@ -0,0 +1,76 @@
+// Octahedral impostors for distant asteroids.  The atlas holds
+// IMPOSTOR_FRAMES x IMPOSTOR_FRAMES views of the asteroid mesh, one per
+// direction, with directions spread over the sphere by an octahedral map.
+// Asteroids spin about every axis, so the whole sphere is covered rather
+// than only the upper hemisphere.
+
+#ifndef IMPOSTOR_FRAMES
+#define IMPOSTOR_FRAMES 8
+#endif
+
+// Mesh and impostor swap over a band of camera distance ending at
+// impostorDistance; the mesh fades out as the impostor fades in
+uniform float impostorDistance;
+uniform float impostorFadeRange;
+uniform float boundingRadius;   // Mesh bounding sphere at unit scale
+
+vec2 signNotZero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Unit direction to [-1, 1]^2 and back
+vec2 octahedralEncode(vec3 v)
+{
+    v /= abs(v.x) + abs(v.y) + abs(v.z);
+    vec2 e = v.xy;
+    if (v.z < 0.0) e = (1.0 - abs(v.yx)) * signNotZero(v.xy);
+    return e;
+}
+
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0) v.xy = (1.0 - abs(v.yx)) * signNotZero(v.xy);
+    return normalize(v);
+}
+
+// Atlas frame closest to an object-space view direction, and the
+// direction a frame was baked from
+ivec2 impostorFrame(vec3 direction)
+{
+    vec2 cell = (octahedralEncode(direction) * 0.5 + 0.5) * float(IMPOSTOR_FRAMES);
+    return clamp(ivec2(cell), ivec2(0), ivec2(IMPOSTOR_FRAMES - 1));
+}
+
+vec3 frameDirection(ivec2 frame)
+{
+    return octahedralDecode((vec2(frame) + 0.5) / float(IMPOSTOR_FRAMES) * 2.0 - 1.0);
+}
+
+// Image-plane axes of a frame looking back along `direction`
+void frameBasis(vec3 direction, out vec3 right, out vec3 up)
+{
+    vec3 reference = abs(direction.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    right = normalize(cross(reference, direction));
+    up = cross(direction, right);
+}
+
+// How much of an asteroid is drawn as mesh: 1 nearer than the fade band,
+// 0 past it.  Uses the same distance as asteroid_cull.comp.
+float impostorFade(vec3 position, vec3 scale)
+{
+    float radius = boundingRadius * max(scale.x, max(scale.y, scale.z));
+    float distanceToCamera = max(distance(position, viewPos) - radius, 0.0);
+    return clamp((impostorDistance - distanceToCamera) / impostorFadeRange, 0.0, 1.0);
+}
+
+// Ordered dither threshold in (0, 1) for a pixel.  The mesh keeps pixels
+// below its fade and the impostor the rest, so the two never overlap.
+float ditherThreshold(vec2 pixel)
+{
+    const float bayer[16] = float[](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0,
+                                    3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+    ivec2 p = ivec2(pixel) & 3;
+    return (bayer[p.y * 4 + p.x] + 0.5) / 16.0;
+}
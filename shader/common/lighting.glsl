@@ -0,0 +1,41 @@
+// Light and camera inputs shared by the lit fragment shaders.
+// Lights come from the clustered light buffer; a shader can define
+// LIGHT_INTENSITY_SCALE to scale every light for its material.
+#include "frame_data.glsl"
+#include "clustered_lights.glsl"
+
+const float PI = 3.14159265359;
+
+#ifndef LIGHT_INTENSITY_SCALE
+#define LIGHT_INTENSITY_SCALE 1.0
+#endif
+
+// Transform a normal map sample from tangent to world space
+vec3 normalFromMap(sampler2D map, vec2 uv, mat3 TBN)
+{
+    vec3 tangentNormal = texture(map, uv).xyz * 2.0 - 1.0;
+    return normalize(TBN * tangentNormal);
+}
+
+// Inverse square falloff softened by the light's radius
+float radiusAttenuation(float distance, float radius)
+{
+    return 1.0 / (1.0 + (distance * distance) / (radius * radius));
+}
+
+// Cluster holding a fragment at worldPos
+uint clusterIndex(vec3 worldPos)
+{
+    float depth = max(-(view * vec4(worldPos, 1.0)).z, 1e-4);
+    uint slice = min(uint(max(log(depth) * clusterDepthScale + clusterDepthBias, 0.0)), uint(CLUSTER_GRID_Z - 1));
+    uvec2 tile = min(uvec2(gl_FragCoord.xy * clusterScale), uvec2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+    return (slice * CLUSTER_GRID_Y + tile.y) * CLUSTER_GRID_X + tile.x;
+}
+
+// Fades a light to exactly zero at its range, so culling never cuts it off
+float rangeWindow(float distance, float range)
+{
+    float ratio = distance / range;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return window * window;
+}
@@ -0,0 +1,13 @@
+// Screen-space motion for temporal anti-aliasing.  Vertex shaders pass
+// this frame's and the previous frame's clip positions; the fragment
+// shader turns them into the UV offset back to where the surface was.
+#include "frame_data.glsl"
+
+vec2 motionVector(vec4 currentClip, vec4 previousClip)
+{
+    // The current position carries this frame's jitter; remove it so
+    // still surfaces have no motion
+    vec2 current = currentClip.xy / currentClip.w - jitter;
+    vec2 previous = previousClip.xy / previousClip.w;
+    return (current - previous) * 0.5;
+}
@@ -0,0 +1,54 @@
+// Cook-Torrance BRDF terms
+#include "lighting.glsl"
+
+// GGX/Trowbridge-Reitz NDF
+float DistributionGGX(vec3 N, vec3 H, float roughness)
+{
+    float a = roughness * roughness;
+    float a2 = a * a;
+    float NdotH = max(dot(N, H), 0.0);
+    float NdotH2 = NdotH * NdotH;
+
+    float nom = a2;
+    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
+    denom = PI * denom * denom;
+
+    return nom / denom;
+}
+
+// Schlick-GGX geometry shadowing function
+float GeometrySchlickGGX(float NdotV, float roughness)
+{
+    float r = (roughness + 1.0);
+    float k = (r * r) / 8.0;
+
+    float nom = NdotV;
+    float denom = NdotV * (1.0 - k) + k;
+
+    return nom / denom;
+}
+
+// Smith's method combining shadowing and masking
+float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness)
+{
+    float NdotV = max(dot(N, V), 0.0);
+    float NdotL = max(dot(N, L), 0.0);
+    float ggx2 = GeometrySchlickGGX(NdotV, roughness);
+    float ggx1 = GeometrySchlickGGX(NdotL, roughness);
+
+    return ggx1 * ggx2;
+}
+
+// Fresnel-Schlick for direct lighting
+vec3 fresnelSchlick(float cosTheta, vec3 F0, float roughness)
+{
+    vec3 scaledF0 = F0 * 0.5;
+    return scaledF0 + (max(vec3(1.0 - roughness), scaledF0) - scaledF0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
+
+//Fresnel-Schlick for environment reflections
+vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness)
+{
+    vec3 scaledF0 = F0 * 0.3;
+    return scaledF0 + (max(vec3(1.0 - roughness), scaledF0) - scaledF0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
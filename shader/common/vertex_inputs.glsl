@@ -0,0 +1,7 @@
+// Vertex attributes shared by the mesh shaders
+layout (location = 0) in vec3 VertexPosition;
+layout (location = 1) in vec3 VertexColor;
+layout (location = 2) in vec3 VertexNormal;
+layout (location = 3) in vec2 VertexTexCoords;
+layout (location = 4) in vec3 VertexTangent;
+layout (location = 5) in vec3 VertexBitangent;
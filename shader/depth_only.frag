@@ -0,0 +1,8 @@
+#version 460
+
+// Depth pre-pass.  Depth comes from the vertex shader and colour writes
+// are masked off, so there is nothing to compute here.
+
+void main()
+{
+}
@@ -0,0 +1,42 @@
+#version 460
+
+in vec2 AtlasUV;
+in vec3 PlanePos;
+in vec4 CurrentClip;
+in vec4 PreviousClip;
+flat in vec3 Center;
+flat in mat3 Rotation;
+flat in vec3 Scale;
+flat in vec3 Direction;
+flat in float Fade;
+
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec2 Velocity;
+
+#include "common/asteroid_shading.glsl"
+#include "common/motion.glsl"
+#include "common/impostor.glsl"
+
+uniform sampler2D albedoAtlas;
+uniform sampler2D normalDepthAtlas;
+
+void main()
+{
+    vec4 albedo = texture(albedoAtlas, AtlasUV);
+    if (albedo.a < 0.5) discard;
+
+    // The mesh draws these pixels while it fades out
+    if (ditherThreshold(gl_FragCoord.xy) < Fade) discard;
+
+    // Rebuild the surface point from the baked depth, so impostors
+    // intersect each other and the meshes correctly
+    vec4 normalDepth = texture(normalDepthAtlas, AtlasUV);
+    vec3 objectPos = PlanePos + Direction * normalDepth.w * boundingRadius;
+    vec3 worldPos = Center + Rotation * (Scale * objectPos);
+    vec4 clip = viewProjection * vec4(worldPos, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+
+    vec3 N = normalize(Rotation * (normalDepth.xyz / Scale));
+    FragColor = vec4(shadeAsteroid(albedo.rgb, N, worldPos), 1.0);
+    Velocity = motionVector(CurrentClip, PreviousClip);
+}
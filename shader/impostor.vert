@@ -0,0 +1,51 @@
+#version 460
+
+// Far-field asteroid drawn as a quad facing the camera.  The quad takes
+// the atlas frame baked from the direction closest to the camera, in the
+// asteroid's own rotating frame, and is turned and scaled with the
+// asteroid.  Corners come from gl_VertexID, so there is no vertex buffer.
+
+#include "common/frame_data.glsl"
+#include "common/asteroid_instance.glsl"
+#include "common/impostor.glsl"
+
+// Index into instances[], read from the impostor level's visible list
+layout (location = 6) in uint InstanceIndex;
+
+uniform float spinTime;
+
+out vec2 AtlasUV;
+out vec3 PlanePos;          // Object-space point on the frame's image plane
+out vec4 CurrentClip;
+out vec4 PreviousClip;
+flat out vec3 Center;
+flat out mat3 Rotation;
+flat out vec3 Scale;
+flat out vec3 Direction;    // Object-space direction the frame was baked from
+flat out float Fade;
+
+void main()
+{
+    AsteroidInstance asteroid = instances[InstanceIndex];
+    mat3 rotation = asteroidRotation(asteroid, spinTime);
+
+    ivec2 frame = impostorFrame(normalize(transpose(rotation) * (viewPos - asteroid.position)));
+    vec3 direction = frameDirection(frame);
+    vec3 right, up;
+    frameBasis(direction, right, up);
+
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    AtlasUV = (vec2(frame) + corner * 0.5 + 0.5) / float(IMPOSTOR_FRAMES);
+    PlanePos = (right * corner.x + up * corner.y) * boundingRadius;
+
+    Center = asteroid.position;
+    Rotation = rotation;
+    Scale = asteroid.scale;
+    Direction = direction;
+    Fade = impostorFade(asteroid.position, asteroid.scale);
+
+    vec3 worldPos = asteroid.position + rotation * (asteroid.scale * PlanePos);
+    gl_Position = viewProjection * vec4(worldPos, 1.0);
+    CurrentClip = gl_Position;
+    PreviousClip = prevViewProjection * vec4(worldPos, 1.0);
+}
@@ -0,0 +1,20 @@
+#version 460
+
+in vec3 ObjectPos;
+in mat3 TBN;
+in float Depth;
+
+layout (location = 0) out vec4 Albedo;       // Alpha marks covered texels
+layout (location = 1) out vec4 NormalDepth;  // Object-space normal, depth
+
+#include "common/asteroid_shading.glsl"
+
+uniform sampler2D albedoMap;
+uniform sampler2D normalMap;
+
+void main()
+{
+    vec2 uv = sphericalUV(ObjectPos);
+    Albedo = vec4(texture(albedoMap, uv).rgb, 1.0);
+    NormalDepth = vec4(normalFromMap(normalMap, uv, TBN), Depth);
+}
@@ -0,0 +1,28 @@
+#version 460
+
+// Renders the asteroid mesh into one frame of the impostor atlas: an
+// orthographic view along the frame's direction, fitted to the bounding
+// sphere.  Everything stays in object space.
+
+#include "common/vertex_inputs.glsl"
+#include "common/impostor.glsl"
+
+out vec3 ObjectPos;
+out mat3 TBN;
+out float Depth;       // Towards the viewer, in bounding radii
+
+uniform ivec2 frame;   // Atlas cell being drawn
+
+void main()
+{
+    vec3 direction = frameDirection(frame);
+    vec3 right, up;
+    frameBasis(direction, right, up);
+
+    ObjectPos = VertexPosition;
+    TBN = mat3(normalize(VertexTangent), normalize(VertexBitangent), normalize(VertexNormal));
+    Depth = dot(VertexPosition, direction) / boundingRadius;
+
+    vec2 plane = vec2(dot(VertexPosition, right), dot(VertexPosition, up)) / boundingRadius;
+    gl_Position = vec4(plane, -Depth, 1.0);
+}
@@ -0,0 +1,12 @@
+#version 460
+
+// Copies the post-processed image to the window
+
+out vec4 FragColor;
+
+uniform sampler2D image;
+
+void main()
+{
+    FragColor = texelFetch(image, ivec2(gl_FragCoord.xy), 0);
+}
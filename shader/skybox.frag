@@ -1,8 +1,13 @@
 #version 450 
 
 in vec3 Vec;
+in vec4 CurrentClip;
+in vec4 PreviousClip;
 
 layout( location = 0 ) out vec4 FragColor;
+layout( location = 1 ) out vec2 Velocity;
+
+#include "common/motion.glsl"
 
 layout(binding=0) uniform samplerCube SkyBoxTex;
 
@@ -10,4 +15,5 @@ void main()
 {
 	vec3 texColor = texture(SkyBoxTex, normalize(Vec)).rgb;
 	FragColor = vec4 ( texColor, 1.0 );
+	Velocity = motionVector(CurrentClip, PreviousClip);
 }
\ No newline at end of file
@@ -2,9 +2,10 @@
 
 layout (location = 0) in vec3 VertexPosition;
 out vec3 Vec;
+out vec4 CurrentClip;  // Directions at infinity, for motion vectors
+out vec4 PreviousClip;
 
-uniform mat4 view;
-uniform mat4 projection;
+#include "common/frame_data.glsl"
 
 void main()
 {
@@ -12,4 +13,8 @@ void main()
     mat4 viewNoTranslation = mat4(mat3(view));
     gl_Position = projection * viewNoTranslation * vec4(VertexPosition, 1.0);
     gl_Position.w = gl_Position.z;
+
+    // Only camera rotation moves the sky; w = 0 drops the translation
+    CurrentClip = viewProjection * vec4(VertexPosition, 0.0);
+    PreviousClip = prevViewProjection * vec4(VertexPosition, 0.0);
 }
@@ -0,0 +1,53 @@
+#version 460
+
+// Temporal reconstruction.  The scene is rendered at reduced resolution
+// with a different sub-pixel jitter each frame; this pass upsamples the
+// new frame to the full-resolution history, reprojects last frame's
+// history along the motion vectors and blends the two.  The history is
+// clamped to the colour range of the new pixel's neighbourhood, which
+// rejects stale colours where something was uncovered or changed.
+
+in vec2 TexCoords;
+layout (location = 0) out vec4 FragColor;
+
+#include "common/frame_data.glsl"
+
+uniform sampler2D currentColor;   // This frame, in the top-left renderScale of the texture
+uniform sampler2D velocityBuffer; // Same layout as currentColor
+uniform sampler2D historyBuffer;  // Last frame's output, full resolution
+uniform vec2 renderScale;
+uniform bool historyValid;
+
+#ifndef HISTORY_WEIGHT
+#define HISTORY_WEIGHT 0.9
+#endif
+
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(currentColor, 0));
+    vec2 lower = 0.5 * texel;
+    vec2 upper = renderScale - 0.5 * texel;
+
+    // The rendered image is shifted by the jitter; sample it where this
+    // pixel's centre landed
+    vec2 currentUV = clamp((TexCoords + jitter * 0.5) * renderScale, lower, upper);
+    vec3 current = texture(currentColor, currentUV).rgb;
+
+    // Colour range of the 3x3 neighbourhood at render resolution
+    vec3 low = current;
+    vec3 high = current;
+    for (int y = -1; y <= 1; ++y) {
+        for (int x = -1; x <= 1; ++x) {
+            vec3 c = texture(currentColor, clamp(currentUV + vec2(x, y) * texel, lower, upper)).rgb;
+            low = min(low, c);
+            high = max(high, c);
+        }
+    }
+
+    vec2 historyUV = TexCoords - texture(velocityBuffer, currentUV).xy;
+    bool onScreen = all(greaterThanEqual(historyUV, vec2(0.0))) && all(lessThanEqual(historyUV, vec2(1.0)));
+    vec3 history = clamp(texture(historyBuffer, historyUV).rgb, low, high);
+
+    float weight = historyValid && onScreen ? HISTORY_WEIGHT : 0.0;
+    FragColor = vec4(mix(current, history, weight), 1.0);
+}
@@ -1,2 +1,8 @@
 #define STB_IMAGE_IMPLEMENTATION
-#include "helper/include/stb/stb_image.h"
\ No newline at end of file
+#include "helper/include/stb/stb_image.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#ifdef _MSC_VER
+#define STBI_MSC_SECURE_CRT
+#endif
+#include "helper/include/stb/stb_image_write.h"
@@ -1,24 +1,51 @@
 #include "texture.h"
+#include "texturecache.h"
 #include "helper/include/stb/stb_image.h"
 #include "helper/glutils.h"
+#include "helper/assetarchive.h"
+#include "helper/startupprofiler.h"
+#include "assetpreloader.h"
+
+namespace {
+    // Cooked textures in the mounted archive are used in place, then images
+    // decoded by the startup preload; anything else goes through the
+    // decoded-texture cache.
+    bool loadImage( const std::string & fName, bool flip, TextureCache::Image & image ) {
+        if( const AssetArchive * archive = AssetArchive::mounted() ) {
+            const AssetArchive::Entry * e = archive->find(fName, AssetArchive::TEXTURE);
+            bool flipped = e != nullptr && (e->flags & TextureCache::FLAG_FLIPPED) != 0;
+            if( e != nullptr && flipped == flip &&
+                TextureCache::deserialize(archive->data(*e), (size_t)e->size, image) ) {
+                return true;
+            }
+        }
+        if( const TextureCache::Image * preloaded = AssetPreloader::image(fName, flip) ) {
+            image = preloaded->borrow();
+            return true;
+        }
+        return TextureCache::load(fName, flip, image);
+    }
+}
 
 /*static*/
 GLuint Texture::loadTexture( const std::string & fName ) {
-    int width, height;
-    unsigned char * data = Texture::loadPixels(fName, width, height);
-	GLuint tex = 0;
-    if( data != nullptr ) {
-        glGenTextures(1, &tex);
-        glBindTexture(GL_TEXTURE_2D, tex);
-        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-
-        Texture::deletePixels(data);
+    StartupProfiler::AssetScope asset(fName);
+    TextureCache::Image image;
+    if( !loadImage(fName, true, image) ) return 0;
+
+    StartupProfiler::Scope timer(StartupProfiler::UPLOAD);
+    GLuint tex = 0;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexStorage2D(GL_TEXTURE_2D, (GLsizei)image.levels.size(), GL_RGBA8, image.width, image.height);
+    for( GLint level = 0; level < (GLint)image.levels.size(); level++ ) {
+        const TextureCache::Level & l = image.levels[level];
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, l.width, l.height, GL_RGBA, GL_UNSIGNED_BYTE, l.data);
     }
 
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
     return tex;
 }
 
@@ -30,36 +57,42 @@ unsigned char *Texture::loadPixels(const std::string &fName, int & width, int &
     int bytesPerPix;
     stbi_set_flip_vertically_on_load(flip);
     unsigned char *data = stbi_load(fName.c_str(), &width, &height, &bytesPerPix, 4);
+    // The texture cache flips rows itself and relies on this staying off
+    stbi_set_flip_vertically_on_load(false);
     return data;
 }
 
 GLuint Texture::loadCubeMap(const std::string &baseName, const std::string &extension) {
+    const char * suffixes[] = { "posx", "negx", "posy", "negy", "posz", "negz" };
+
+    // Resolve all six faces first so storage can be sized from the first one
+    TextureCache::Image faces[6];
+    for( int i = 0; i < 6; i++ ) {
+        std::string texName = baseName + "_" + suffixes[i] + extension;
+        StartupProfiler::AssetScope asset(texName);
+        if( !loadImage(texName, false, faces[i]) ) return 0;
+    }
+
+    StartupProfiler::AssetScope asset(baseName + "_*" + extension);
+    StartupProfiler::Scope timer(StartupProfiler::UPLOAD);
+
     GLuint texID;
     glGenTextures(1, &texID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, texID);
 
-    const char * suffixes[] = { "posx", "negx", "posy", "negy", "posz", "negz" };
-    GLint w, h;
-
-    // Load the first one to get width/height
-    std::string texName = baseName + "_" + suffixes[0] + extension;
-    GLubyte * data = Texture::loadPixels(texName, w, h, false);
-
     // Allocate immutable storage for the whole cube map texture
-    glTexStorage2D(GL_TEXTURE_CUBE_MAP, 1, GL_RGBA8, w, h);
-    glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    stbi_image_free(data);
-
-    // Load the other 5 cube-map faces
-    for( int i = 1; i < 6; i++ ) {
-        std::string texName = baseName + "_" + suffixes[i] + extension;
-        data = Texture::loadPixels(texName, w, h, false);
-        glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        stbi_image_free(data);
+    GLsizei levels = (GLsizei)faces[0].levels.size();
+    glTexStorage2D(GL_TEXTURE_CUBE_MAP, levels, GL_RGBA8, faces[0].width, faces[0].height);
+    for( int i = 0; i < 6; i++ ) {
+        for( GLint level = 0; level < levels && level < (GLint)faces[i].levels.size(); level++ ) {
+            const TextureCache::Level & l = faces[i].levels[level];
+            glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, level, 0, 0, l.width, l.height,
+                GL_RGBA, GL_UNSIGNED_BYTE, l.data);
+        }
     }
 
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
@@ -0,0 +1,262 @@
+#include "texturecache.h"
+#include "helper/hash.h"
+#include "helper/startupprofiler.h"
+#include "helper/include/stb/stb_image.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+using std::string;
+
+namespace {
+    const char DSTEX_MAGIC[4] = { 'D', 'S', 'T', 'X' };
+    const uint32_t DSTEX_VERSION = 2;
+    const size_t DSTEX_DATA_OFFSET = 256;
+
+    struct DstexHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceHash;
+        uint64_t sourceSize;
+        uint64_t sourceModified;
+        uint32_t width;
+        uint32_t height;
+        uint32_t levelCount;
+        uint32_t flags;
+        uint64_t offsets[TextureCache::MAX_LEVELS];
+    };
+    static_assert(sizeof(DstexHeader) <= DSTEX_DATA_OFFSET, "dstex header overlaps texel data");
+
+    size_t levelSize(int w, int h) {
+        return (size_t)w * (size_t)h * 4;
+    }
+
+    void flipRows(unsigned char* pixels, int w, int h) {
+        size_t stride = levelSize(w, 1);
+        std::vector<unsigned char> row(stride);
+        for (int y = 0; y < h / 2; ++y) {
+            unsigned char* top = pixels + y * stride;
+            unsigned char* bottom = pixels + (h - 1 - y) * stride;
+            std::memcpy(row.data(), top, stride);
+            std::memcpy(top, bottom, stride);
+            std::memcpy(bottom, row.data(), stride);
+        }
+    }
+}
+
+string TextureCache::directory = "cache/textures";
+bool TextureCache::enabled = true;
+
+string TextureCache::entryPath(uint64_t key) {
+    return directory + "/" + Hash::toHex(key) + ".dstex";
+}
+
+bool TextureCache::stampPath(const string& fileName, bool flip, Source& source, string& path) {
+    if (!MappedFile::fileStamp(fileName, source.size, source.modified)) return false;
+    uint64_t key = Hash::string(fileName);
+    key = Hash::combine(key, source.size);
+    key = Hash::combine(key, source.modified);
+    key = Hash::combine(Hash::combine(key, flip ? 1 : 0), DSTEX_VERSION);
+    path = entryPath(key);
+    return true;
+}
+
+bool TextureCache::load(const string& fileName, bool flip, Image& image) {
+    if (loadCached(fileName, flip, image)) return true;
+
+    std::vector<unsigned char> bytes;
+    if (!MappedFile::readFile(fileName, bytes)) {
+        std::cerr << "Unable to open texture: " << fileName << std::endl;
+        return false;
+    }
+    return loadFromMemory(bytes.data(), bytes.size(), flip, image, fileName);
+}
+
+bool TextureCache::loadCached(const string& fileName, bool flip, Image& image) {
+    if (!enabled) return false;
+
+    Source source;
+    string path;
+    if (!stampPath(fileName, flip, source, path)) return false;
+
+    StartupProfiler::Scope timer(StartupProfiler::READ);
+    MappedFile mapping;
+    if (!mapping.open(path)) return false;
+
+    Source stored;
+    if (deserialize(mapping.data(), mapping.size(), image, &stored) &&
+        stored.size == source.size && stored.modified == source.modified) {
+        image.mapping = std::move(mapping);
+        return true;
+    }
+    image = Image();
+    return false;
+}
+
+bool TextureCache::loadFromMemory(const unsigned char* bytes, size_t size, bool flip, Image& image, const string& fileName) {
+    Source source;
+    source.hash = Hash::bytes(bytes, size);
+
+    string path;
+    if (fileName.empty() || !stampPath(fileName, flip, source, path)) {
+        source.size = source.modified = 0;
+        path = entryPath(Hash::combine(Hash::combine(source.hash, flip ? 1 : 0), DSTEX_VERSION));
+    }
+
+    // Warm start: map the decoded texels and hand them out as-is
+    if (enabled) {
+        StartupProfiler::Scope timer(StartupProfiler::READ);
+        MappedFile mapping;
+        if (mapping.open(path)) {
+            Source stored;
+            if (deserialize(mapping.data(), mapping.size(), image, &stored) && stored.hash == source.hash) {
+                image.mapping = std::move(mapping);
+                return true;
+            }
+            image = Image();
+        }
+    }
+
+    // Cold start: decode, flip, build the mip chain and persist it
+    {
+        StartupProfiler::Scope timer(StartupProfiler::DECODE);
+        int w = 0, h = 0, bytesPerPix = 0;
+        unsigned char* pixels = stbi_load_from_memory(bytes, (int)size, &w, &h, &bytesPerPix, 4);
+        if (pixels == nullptr) return false;
+
+        if (flip) flipRows(pixels, w, h);
+        buildMipChain(pixels, w, h, image);
+        stbi_image_free(pixels);
+    }
+
+    if (enabled) {
+        std::vector<unsigned char> blob;
+        serialize(image, source, flip, blob);
+        if (!MappedFile::writeFileAtomic(path, blob.data(), blob.size())) {
+            std::cerr << "[WARNING] Unable to write texture cache entry: " << path << std::endl;
+        }
+    }
+    return true;
+}
+
+void TextureCache::buildMipChain(const unsigned char* pixels, int w, int h, Image& image) {
+    image.width = w;
+    image.height = h;
+    image.levels.clear();
+
+    // Size the whole chain up front so level pointers stay valid
+    size_t total = 0;
+    int levelW = w, levelH = h;
+    uint32_t count = 0;
+    while (count < MAX_LEVELS) {
+        total += levelSize(levelW, levelH);
+        ++count;
+        if (levelW == 1 && levelH == 1) break;
+        levelW = std::max(1, levelW / 2);
+        levelH = std::max(1, levelH / 2);
+    }
+    image.storage.resize(total);
+
+    unsigned char* dst = image.storage.data();
+    std::memcpy(dst, pixels, levelSize(w, h));
+    levelW = w;
+    levelH = h;
+    for (uint32_t i = 0; i < count; ++i) {
+        Level level;
+        level.data = dst;
+        level.width = levelW;
+        level.height = levelH;
+        level.size = levelSize(levelW, levelH);
+        image.levels.push_back(level);
+
+        if (i + 1 == count) break;
+
+        // 2x2 box filter into the next level
+        const unsigned char* src = dst;
+        int srcW = levelW, srcH = levelH;
+        dst += level.size;
+        levelW = std::max(1, levelW / 2);
+        levelH = std::max(1, levelH / 2);
+        for (int y = 0; y < levelH; ++y) {
+            int y0 = std::min(y * 2, srcH - 1), y1 = std::min(y * 2 + 1, srcH - 1);
+            for (int x = 0; x < levelW; ++x) {
+                int x0 = std::min(x * 2, srcW - 1), x1 = std::min(x * 2 + 1, srcW - 1);
+                for (int c = 0; c < 4; ++c) {
+                    int sum = src[(y0 * srcW + x0) * 4 + c] + src[(y0 * srcW + x1) * 4 + c] +
+                              src[(y1 * srcW + x0) * 4 + c] + src[(y1 * srcW + x1) * 4 + c];
+                    dst[(y * levelW + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+    }
+}
+
+void TextureCache::serialize(const Image& image, const Source& source, bool flip, std::vector<unsigned char>& out) {
+    DstexHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, DSTEX_MAGIC, 4);
+    header.version = DSTEX_VERSION;
+    header.sourceHash = source.hash;
+    header.sourceSize = source.size;
+    header.sourceModified = source.modified;
+    header.width = (uint32_t)image.width;
+    header.height = (uint32_t)image.height;
+    header.levelCount = (uint32_t)image.levels.size();
+    header.flags = flip ? TextureCache::FLAG_FLIPPED : 0;
+
+    size_t offset = DSTEX_DATA_OFFSET;
+    for (uint32_t i = 0; i < header.levelCount; ++i) {
+        header.offsets[i] = offset;
+        offset += image.levels[i].size;
+    }
+
+    out.assign(offset, 0);
+    std::memcpy(out.data(), &header, sizeof(header));
+    for (uint32_t i = 0; i < header.levelCount; ++i) {
+        std::memcpy(out.data() + header.offsets[i], image.levels[i].data, image.levels[i].size);
+    }
+}
+
+bool TextureCache::deserialize(const unsigned char* data, size_t size, Image& image, Source* source) {
+    if (size < DSTEX_DATA_OFFSET) return false;
+
+    DstexHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, DSTEX_MAGIC, 4) != 0 || header.version != DSTEX_VERSION) return false;
+    if (header.width == 0 || header.height == 0 ||
+        header.width > (uint32_t)INT_MAX || header.height > (uint32_t)INT_MAX) return false;
+
+    // No more levels than a full chain down to 1x1
+    uint32_t fullChain = 1;
+    for (uint32_t extent = std::max(header.width, header.height); extent > 1; extent >>= 1) ++fullChain;
+    if (header.levelCount == 0 || header.levelCount > MAX_LEVELS || header.levelCount > fullChain) return false;
+
+    image.width = (int)header.width;
+    image.height = (int)header.height;
+    image.levels.clear();
+
+    int levelW = image.width, levelH = image.height;
+    for (uint32_t i = 0; i < header.levelCount; ++i) {
+        Level level;
+        level.width = levelW;
+        level.height = levelH;
+        level.size = levelSize(levelW, levelH);
+        if (header.offsets[i] > size || level.size > size - header.offsets[i]) {
+            image.levels.clear();
+            return false;
+        }
+        level.data = data + header.offsets[i];
+        image.levels.push_back(level);
+        levelW = std::max(1, levelW / 2);
+        levelH = std::max(1, levelH / 2);
+    }
+
+    if (source) {
+        source->hash = header.sourceHash;
+        source->size = header.sourceSize;
+        source->modified = header.sourceModified;
+    }
+    return true;
+}
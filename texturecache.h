@@ -0,0 +1,91 @@
+#pragma once
+
+#include "helper/mappedfile.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Cache of decoded RGBA8 texel data.
+//
+// The decoded, flipped and mip-mapped result of each source image is written
+// to cache/textures/<key>.dstex.  Images loaded from a file are keyed on the
+// path, size and modification time, so a warm start maps the entry without
+// reading or hashing the source; images that only exist in memory are keyed
+// on their content hash.  Every entry records the source's content hash, and
+// it is checked whenever the source bytes are in hand.
+class TextureCache {
+public:
+    static const uint32_t MAX_LEVELS = 16;
+    static const uint32_t FLAG_FLIPPED = 1;
+
+    // Identity of the source an entry was built from
+    struct Source {
+        uint64_t hash = 0;
+        uint64_t size = 0;
+        uint64_t modified = 0;
+    };
+
+    struct Level {
+        const unsigned char* data = nullptr;
+        int width = 0;
+        int height = 0;
+        size_t size = 0;
+    };
+
+    // Decoded image with its full mip chain, backed either by a cache
+    // mapping or by memory owned by the image itself.
+    class Image {
+    public:
+        int width = 0;
+        int height = 0;
+        std::vector<Level> levels;
+
+        bool valid() const { return !levels.empty(); }
+        bool fromCache() const { return mapping.isOpen(); }
+
+        // Non-owning view of the same texels; must not outlive this image
+        Image borrow() const {
+            Image view;
+            view.width = width;
+            view.height = height;
+            view.levels = levels;
+            return view;
+        }
+
+    private:
+        friend class TextureCache;
+        MappedFile mapping;
+        std::vector<unsigned char> storage;
+    };
+
+    // Loads fileName through the cache.  Returns false if the image could
+    // neither be found in the cache nor decoded.
+    static bool load(const std::string& fileName, bool flip, Image& image);
+
+    // Warm half of load(): maps the entry for fileName if its size and
+    // modification time still match, without reading the file itself.
+    static bool loadCached(const std::string& fileName, bool flip, Image& image);
+
+    // Same as load() for an encoded image that is already in memory.  Pass
+    // the file it was read from, if any, so the entry is keyed on the file.
+    static bool loadFromMemory(const unsigned char* bytes, size_t size, bool flip, Image& image,
+                               const std::string& fileName = std::string());
+
+    static void setDirectory(const std::string& dir) { directory = dir; }
+    static void setEnabled(bool value) { enabled = value; }
+
+    // Builds the mip chain for RGBA8 pixels in place of image's storage
+    static void buildMipChain(const unsigned char* pixels, int w, int h, Image& image);
+
+    // Serialized form of an image, shared with the asset archive
+    static void serialize(const Image& image, const Source& source, bool flip, std::vector<unsigned char>& out);
+    static bool deserialize(const unsigned char* data, size_t size, Image& image, Source* source = nullptr);
+
+private:
+    static std::string directory;
+    static bool enabled;
+
+    static std::string entryPath(uint64_t key);
+    static bool stampPath(const std::string& fileName, bool flip, Source& source, std::string& path);
+};
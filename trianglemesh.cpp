@@ -1,4 +1,11 @@
 #include "trianglemesh.h"
+#include "helper/startupprofiler.h"
+#include "helper/glstatecache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
 
 void TriangleMesh::initBuffers(
         std::vector<GLuint> * indices,
@@ -7,6 +14,26 @@ void TriangleMesh::initBuffers(
         std::vector<GLfloat> * texCoords,
         std::vector<GLfloat> * tangents
 ) {
+    // Must have data for indices, points, and normals
+    if( indices == nullptr || points == nullptr || normals == nullptr ) {
+        if( ! buffers.empty() ) deleteBuffers();
+        return;
+    }
+
+    initBuffers(
+            (GLsizei)indices->size(), indices->data(),
+            (GLsizei)(points->size() / 3), points->data(), normals->data(),
+            texCoords != nullptr ? texCoords->data() : nullptr,
+            tangents != nullptr ? tangents->data() : nullptr
+    );
+}
+
+void TriangleMesh::initBuffers(
+        GLsizei nIndices, const GLuint * indices,
+        GLsizei nVertices, const GLfloat * points, const GLfloat * normals,
+        const GLfloat * texCoords,
+        const GLfloat * tangents
+) {
 
     if( ! buffers.empty() ) deleteBuffers();
 
@@ -14,40 +41,46 @@ void TriangleMesh::initBuffers(
     if( indices == nullptr || points == nullptr || normals == nullptr )
         return;
 
-    nVerts = (GLuint)indices->size();
+    StartupProfiler::Scope timer(StartupProfiler::UPLOAD);
+    nVerts = (GLuint)nIndices;
+    lods.assign(1, Lod{ 0, nVerts });
+
+    // The element buffer binding below belongs to whichever VAO is bound,
+    // and draws no longer unbind theirs
+    GLStateCache::bindVertexArray(0);
 
     GLuint indexBuf = 0, posBuf = 0, normBuf = 0, tcBuf = 0, tangentBuf = 0;
     glGenBuffers(1, &indexBuf);
     buffers.push_back(indexBuf);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuf);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices->size() * sizeof(GLuint), indices->data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, nIndices * sizeof(GLuint), indices, GL_STATIC_DRAW);
 
     glGenBuffers(1, &posBuf);
     buffers.push_back(posBuf);
     glBindBuffer(GL_ARRAY_BUFFER, posBuf);
-    glBufferData(GL_ARRAY_BUFFER, points->size() * sizeof(GLfloat), points->data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, nVertices * 3 * sizeof(GLfloat), points, GL_STATIC_DRAW);
 
     glGenBuffers(1, &normBuf);
     buffers.push_back(normBuf);
     glBindBuffer(GL_ARRAY_BUFFER, normBuf);
-    glBufferData(GL_ARRAY_BUFFER, normals->size() * sizeof(GLfloat), normals->data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, nVertices * 3 * sizeof(GLfloat), normals, GL_STATIC_DRAW);
 
     if( texCoords != nullptr ) {
         glGenBuffers(1, &tcBuf);
         buffers.push_back(tcBuf);
         glBindBuffer(GL_ARRAY_BUFFER, tcBuf);
-        glBufferData(GL_ARRAY_BUFFER, texCoords->size() * sizeof(GLfloat), texCoords->data(), GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, nVertices * 2 * sizeof(GLfloat), texCoords, GL_STATIC_DRAW);
     }
 
     if( tangents != nullptr ) {
         glGenBuffers(1, &tangentBuf);
         buffers.push_back(tangentBuf);
         glBindBuffer(GL_ARRAY_BUFFER, tangentBuf);
-        glBufferData(GL_ARRAY_BUFFER, tangents->size() * sizeof(GLfloat), tangents->data(), GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, nVertices * 4 * sizeof(GLfloat), tangents, GL_STATIC_DRAW);
     }
 
     glGenVertexArrays( 1, &vao );
-    glBindVertexArray(vao);
+    GLStateCache::bindVertexArray(vao);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuf);
 
@@ -74,15 +107,87 @@ void TriangleMesh::initBuffers(
         glEnableVertexAttribArray(3);  // Tangents
     }
 
-    glBindVertexArray(0);
+    GLStateCache::bindVertexArray(0);
 }
 
 void TriangleMesh::render() const {
     if(vao == 0) return;
 
-    glBindVertexArray(vao);
+    GLStateCache::bindVertexArray(vao);
     glDrawElements(GL_TRIANGLES, nVerts, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+}
+
+void TriangleMesh::renderInstanced(GLsizei instances) const {
+    if(vao == 0 || instances <= 0) return;
+
+    GLStateCache::bindVertexArray(vao);
+    glDrawElementsInstanced(GL_TRIANGLES, nVerts, GL_UNSIGNED_INT, 0, instances);
+}
+
+void TriangleMesh::generateLods(int levels, int baseGridSize) {
+    if( vao == 0 || levels <= 0 ) return;
+
+    GLuint indexBuf = buffers[0], posBuf = buffers[1];
+    GLint posBytes = 0;
+    glGetNamedBufferParameteriv(posBuf, GL_BUFFER_SIZE, &posBytes);
+
+    std::vector<GLuint> indices(nVerts);
+    std::vector<GLfloat> points(posBytes / sizeof(GLfloat));
+    glGetNamedBufferSubData(indexBuf, 0, nVerts * sizeof(GLuint), indices.data());
+    glGetNamedBufferSubData(posBuf, 0, posBytes, points.data());
+    size_t nVertices = points.size() / 3;
+    if( nVertices == 0 ) return;
+
+    GLfloat lo[3] = { points[0], points[1], points[2] }, hi[3] = { points[0], points[1], points[2] };
+    for( size_t v = 0; v < nVertices; ++v ) {
+        for( int a = 0; a < 3; ++a ) {
+            lo[a] = std::min(lo[a], points[v * 3 + a]);
+            hi[a] = std::max(hi[a], points[v * 3 + a]);
+        }
+    }
+    GLfloat extent = std::max(hi[0] - lo[0], std::max(hi[1] - lo[1], hi[2] - lo[2]));
+    if( extent <= 0.0f ) return;
+
+    std::vector<GLuint> all(indices);
+    std::vector<GLuint> remap(nVertices);
+    lods.assign(1, Lod{ 0, nVerts });
+
+    for( int level = 1; level <= levels; ++level ) {
+        int grid = std::max(2, baseGridSize >> (level - 1));
+        GLfloat cell = extent / grid;
+
+        // Every vertex collapses onto the first vertex seen in its cell
+        std::unordered_map<uint64_t, GLuint> representative;
+        for( size_t v = 0; v < nVertices; ++v ) {
+            uint64_t key = 0;
+            for( int a = 0; a < 3; ++a ) {
+                uint64_t c = (uint64_t)std::min(grid - 1, (int)std::floor((points[v * 3 + a] - lo[a]) / cell));
+                key = (key << 21) | c;
+            }
+            remap[v] = representative.emplace(key, (GLuint)v).first->second;
+        }
+
+        // Keep the triangles that did not collapse
+        Lod lod{ (GLuint)all.size(), 0 };
+        for( size_t i = 0; i + 2 < indices.size(); i += 3 ) {
+            GLuint a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+            if( a == b || b == c || a == c ) continue;
+            all.push_back(a);
+            all.push_back(b);
+            all.push_back(c);
+        }
+        lod.indexCount = (GLuint)all.size() - lod.firstIndex;
+        if( lod.indexCount == 0 ) break;
+        lods.push_back(lod);
+    }
+
+    // Replace the element buffer with one holding every level
+    GLuint newIndexBuf = 0;
+    glCreateBuffers(1, &newIndexBuf);
+    glNamedBufferData(newIndexBuf, all.size() * sizeof(GLuint), all.data(), GL_STATIC_DRAW);
+    glVertexArrayElementBuffer(vao, newIndexBuf);
+    glDeleteBuffers(1, &indexBuf);
+    buffers[0] = newIndexBuf;
 }
 
 TriangleMesh::~TriangleMesh() {
@@ -98,5 +203,6 @@ void TriangleMesh::deleteBuffers() {
     if( vao != 0 ) {
         glDeleteVertexArrays(1, &vao);
         vao = 0;
+        GLStateCache::invalidate();     // The name may be reused
     }
 }
\ No newline at end of file
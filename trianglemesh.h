@@ -7,6 +7,14 @@
 
 class TriangleMesh : public Drawable {
 
+public:
+    // A level of detail: a range of the element buffer.  Every level
+    // indexes the same vertex buffers.
+    struct Lod {
+        GLuint firstIndex;
+        GLuint indexCount;
+    };
+
 protected:
 
     GLuint nVerts;     // Number of vertices
@@ -15,6 +23,9 @@ protected:
     // Vertex buffers
     std::vector<GLuint> buffers;
 
+    // Level 0 is the full mesh
+    std::vector<Lod> lods;
+
     virtual void initBuffers(
             std::vector<GLuint> * indices,
             std::vector<GLfloat> * points,
@@ -23,11 +34,30 @@ protected:
             std::vector<GLfloat> * tangents = nullptr
             );
 
+    // Same as above for data that is not held in vectors (e.g. a cooked
+    // mesh inside a memory-mapped asset archive).
+    void initBuffers(
+            GLsizei nIndices, const GLuint * indices,
+            GLsizei nVertices, const GLfloat * points, const GLfloat * normals,
+            const GLfloat * texCoords = nullptr,
+            const GLfloat * tangents = nullptr
+            );
+
     virtual void deleteBuffers();
 
 public:
     virtual ~TriangleMesh();
     virtual void render() const;
+    // Draws `instances` copies in one call; the shader tells them apart
+    // with gl_InstanceID
+    void renderInstanced(GLsizei instances) const;
+
+    // Builds `levels` extra levels of detail by vertex clustering, each on
+    // a grid half as fine as the one before, and appends them to the
+    // element buffer.  Reads the mesh back from the GPU, so call it once
+    // after loading.
+    void generateLods(int levels, int baseGridSize = 32);
+    const std::vector<Lod>& getLods() const { return lods; }
     GLuint getVao() const { return vao; }
     GLuint getElementBuffer() { return buffers[0]; }
     GLuint getPositionBuffer() { return buffers[1]; }